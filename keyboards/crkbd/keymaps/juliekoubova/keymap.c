@@ -65,10 +65,44 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
   ),
 };
 
+#ifdef OLED_ENABLE
+bool oled_task_user(void) {
+    static vim_mode_t showing = 0;
+
+    // the ex command line, and v-block mode
+    vim_mode_t mode = is_keyboard_master() ? vim_get_mode() : 0;
+    if (mode != VIM_MODE_EX && mode != VIM_MODE_VBLOCK) {
+        mode = 0;
+    }
+    if (mode != showing) {
+        oled_clear();
+        showing = mode;
+    }
+    if (!mode) {
+        return true;
+    }
+
+    oled_set_cursor(0, 0);
+    if (mode == VIM_MODE_EX) {
+        oled_write_char(':', false);
+        oled_write_ln(vim_ex_command(), false);
+    } else {
+        oled_write_ln_P(PSTR("-- VISUAL BLOCK --"), false);
+    }
+    return false;
+}
+#endif
+
 void keyboard_post_init_user(void) {
 #ifdef VIM_DEBUG
     debug_enable = true;
 #endif
+    vim_init();
+}
+
+bool shutdown_user(bool jump_to_bootloader) {
+    vim_shutdown();
+    return true;
 }
 
 
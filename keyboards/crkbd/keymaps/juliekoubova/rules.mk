@@ -10,7 +10,7 @@ GRAVE_ESC_ENABLE = no
 KEY_OVERRIDE_ENABLE = no
 LTO_ENABLE = yes
 MAGIC_ENABLE = no
-MOUSEKEY_ENABLE = no
+MOUSEKEY_ENABLE = yes
 MUSIC_ENABLE = no
 OS_DETECTION_ENABLE = yes
 SPACE_CADET_ENABLE = no
@@ -10,6 +10,8 @@
 #define RGB_MATRIX_DEFAULT_VAL 0
 
 #define VIM_DEBUG
+#define VIM_HOST_EEPROM
+#define EECONFIG_USER_DATA_SIZE 4
 
 #undef ENABLE_RGB_MATRIX_ALPHAS_MODS
 #undef ENABLE_RGB_MATRIX_GRADIENT_UP_DOWN
@@ -47,12 +47,22 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 
 #ifdef OS_DETECTION_ENABLE
 
-static bool is_apple = false;
-
 bool process_detected_host_os_user(os_variant_t os) {
     dprintf("OS detected: %d\n", os);
-    is_apple = os == OS_MACOS || os == OS_IOS;
-    vim_set_apple(is_apple);
+    switch (os) {
+        case OS_MACOS:
+        case OS_IOS:
+            vim_set_host(VIM_HOST_MAC);
+            break;
+        case OS_LINUX:
+            vim_set_host(VIM_HOST_LINUX);
+            break;
+        case OS_WINDOWS:
+            vim_set_host(VIM_HOST_WINDOWS);
+            break;
+        default:
+            break;
+    }
     return true;
 }
 
@@ -77,7 +87,7 @@ bool rgb_matrix_indicators_advanced_user(uint8_t led_min, uint8_t led_max) {
             if (get_highest_layer(layer_state) > 0) {
                 uint16_t keycode = keymap_key_to_keycode(layer, (keypos_t){col, row});
                 if (keycode > KC_TRNS) {
-                    if (is_apple) {
+                    if (vim_get_host() == VIM_HOST_MAC) {
                         rgb_matrix_set_color(index, RGB_RED);
                     } else {
                         rgb_matrix_set_color(index, RGB_GREEN);
@@ -100,6 +110,9 @@ bool rgb_matrix_indicators_advanced_user(uint8_t led_min, uint8_t led_max) {
                     case VIM_MODE_VLINE:
                         rgb_matrix_set_color(index, RGB_SPRINGGREEN);
                         break;
+                    case VIM_MODE_VBLOCK:
+                        rgb_matrix_set_color(index, RGB_ORANGE);
+                        break;
                     default:
                         rgb_matrix_set_color(index, RGB_BLUE);
                         break;
@@ -119,10 +132,24 @@ void keyboard_post_init_user(void) {
 #ifdef VIM_DEBUG
     debug_enable = true;
 #endif
+    vim_init();
+}
+
+#ifdef COMMAND_ENABLE
+bool command_extra(uint8_t code) {
+    return vim_command_extra(code);
+}
+#endif
+
+bool shutdown_user(bool jump_to_bootloader) {
+    vim_shutdown();
+    return true;
 }
 
 
-bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+// there are no tap-hold keys here, so command mode keys can skip the rest of
+// QMK's processing
+bool pre_process_record_user(uint16_t keycode, keyrecord_t *record) {
     return process_record_vim(keycode, record, QK_VIM);
 }
 
@@ -1,8 +1,30 @@
 ifeq ($(strip $(VIM_MODE_ENABLE)), yes)
+  SRC += vim/debug.c
+  SRC += vim/ex.c
+  SRC += vim/host.c
+  SRC += vim/invariants.c
+  SRC += vim/macro.c
   SRC += vim/pending.c
   SRC += vim/perform_action.c
+  SRC += vim/profile.c
+  SRC += vim/recorder.c
+  SRC += vim/repeat.c
+  SRC += vim/search.c
+  SRC += vim/selection.c
+  SRC += vim/snapshot.c
   SRC += vim/statemachine.c
+  SRC += vim/stats.c
+  SRC += vim/timer_wheel.c
   SRC += vim/vim.c
   SRC += vim/vim_mode.c
   SRC += vim/vim_send.c
+
+  # VIM_HOST = windows, mac or linux sends that host's shortcuts only
+  ifeq ($(strip $(VIM_HOST)), windows)
+    OPT_DEFS += -DVIM_HOST=VIM_HOST_WINDOWS
+  else ifeq ($(strip $(VIM_HOST)), mac)
+    OPT_DEFS += -DVIM_HOST=VIM_HOST_MAC
+  else ifeq ($(strip $(VIM_HOST)), linux)
+    OPT_DEFS += -DVIM_HOST=VIM_HOST_LINUX
+  endif
 endif
@@ -0,0 +1,95 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Times keys typed in insert mode, on the host:
+//
+//     make bench
+//
+// `inline check` is process_record_vim as keymaps call it, `engine` is
+// vim_process_record, where every key went before the check was inlined. With
+// VIM_DEBUG, the engine is timed again with the log off, on but filtered out
+// by the level, and writing a KEY message for every event. Only the ring is
+// timed, it is printed to /dev/null in between.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "harness.h"
+#include "vim.h"
+
+#define BENCH_BATCH 4096
+#define BENCH_BATCHES 256
+
+typedef bool (*bench_process_t)(uint16_t keycode, const keyrecord_t *record, uint16_t vim_keycode);
+
+static bool bench_inline(uint16_t keycode, const keyrecord_t *record, uint16_t vim_keycode) {
+    return process_record_vim(keycode, record, vim_keycode);
+}
+
+static volatile uint16_t bench_passed = 0;
+
+static double bench_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void bench_drain(void) {
+#ifdef VIM_DEBUG
+    fflush(stdout);
+    int out = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    for (uint16_t i = 0; i < VIM_LOG_BUFFER_SIZE / 16 + 1; i++) {
+        vim_log_flush();
+    }
+    fflush(stdout);
+    dup2(out, STDOUT_FILENO);
+    close(null);
+    close(out);
+#endif
+}
+
+static void bench(const char *name, bench_process_t process) {
+    double elapsed = 0;
+    for (uint16_t batch = 0; batch < BENCH_BATCHES; batch++) {
+        double start = bench_ns();
+        for (uint16_t i = 0; i < BENCH_BATCH; i++) {
+            keyrecord_t record = {.event = {.pressed = !(i & 1)}};
+            bench_passed += process(KC_A + (i >> 1) % 26, &record, QK_VIM);
+        }
+        elapsed += bench_ns() - start;
+        bench_drain();
+    }
+    printf("  %-28s %6.1f ns/event\n", name, elapsed / BENCH_BATCH / BENCH_BATCHES);
+}
+
+int main(void) {
+    harness_run(1);
+    EXPECT(vim_get_mode() == VIM_MODE_INSERT);
+    bench("inline check", bench_inline);
+    bench("engine", vim_process_record);
+#ifdef VIM_DEBUG
+    debug_enable = true;
+    bench("engine, log below the level", vim_process_record);
+    vim_set_log_level(VIM_LOG_TRACE);
+    bench("engine, KEY logged", vim_process_record);
+    debug_enable = false;
+#endif
+    EXPECT(bench_passed == (uint16_t)(BENCH_BATCH * BENCH_BATCHES));
+    return harness_done();
+}
@@ -0,0 +1,182 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs fuzz_vim.c without libFuzzer, for compilers that don't have it:
+//
+//     fuzz_vim FILE_OR_DIR...            runs every input once
+//     fuzz_vim -runs=N [-seed=S] [DIR]   N random inputs, or mutated seeds
+//
+// An input that fails is written to crash-<seed>-<run>, the way libFuzzer
+// names its crash files, and can be passed back to reproduce it.
+
+#include <dirent.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FUZZ_MAX_INPUT 4096
+#define FUZZ_MAX_SEEDS 256
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+typedef struct {
+    uint8_t data[FUZZ_MAX_INPUT];
+    size_t  size;
+} fuzz_input_t;
+
+static fuzz_input_t  fuzz_seeds[FUZZ_MAX_SEEDS];
+static size_t        fuzz_seed_count = 0;
+static fuzz_input_t  fuzz_current;
+static const char   *fuzz_current_name = NULL;
+static char          fuzz_crash_name[64];
+static unsigned long fuzz_events = 0;
+static uint64_t      fuzz_random;
+
+static uint32_t fuzz_next(void) {
+    fuzz_random ^= fuzz_random << 13;
+    fuzz_random ^= fuzz_random >> 7;
+    fuzz_random ^= fuzz_random << 17;
+    return (uint32_t)(fuzz_random >> 16);
+}
+
+static void fuzz_crashed(int signal) {
+    fflush(stdout);
+    if (fuzz_current_name) {
+        fprintf(stderr, "failed on %s\n", fuzz_current_name);
+    } else {
+        FILE *file = fopen(fuzz_crash_name, "wb");
+        if (file) {
+            fwrite(fuzz_current.data, 1, fuzz_current.size, file);
+            fclose(file);
+        }
+        fprintf(stderr, "failed, input written to %s\n", fuzz_crash_name);
+    }
+    _exit(1);
+}
+
+static void fuzz_run(void) {
+    fuzz_events += fuzz_current.size / 3;
+    LLVMFuzzerTestOneInput(fuzz_current.data, fuzz_current.size);
+}
+
+static bool fuzz_read(const char *path, fuzz_input_t *input) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    input->size = fread(input->data, 1, sizeof(input->data), file);
+    fclose(file);
+    return true;
+}
+
+static void fuzz_add(const char *path) {
+    struct stat info;
+    if (stat(path, &info) == 0 && S_ISDIR(info.st_mode)) {
+        DIR *dir = opendir(path);
+        for (struct dirent *entry; dir && (entry = readdir(dir));) {
+            if (entry->d_name[0] != '.') {
+                char child[1024];
+                snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+                fuzz_add(child);
+            }
+        }
+        if (dir) {
+            closedir(dir);
+        }
+    } else if (fuzz_seed_count < FUZZ_MAX_SEEDS) {
+        if (fuzz_read(path, &fuzz_current)) {
+            fuzz_current_name = path;
+            fuzz_run();
+            fuzz_seeds[fuzz_seed_count++] = fuzz_current;
+        }
+    }
+}
+
+// Mostly short gaps and no extra mods, so that a run gets far enough into a
+// command for it to matter.
+static void fuzz_random_event(uint8_t *event) {
+    event[0] = fuzz_next();
+    event[1] = fuzz_next() % 8 ? 0 : fuzz_next();
+    event[2] = fuzz_next() % 16 ? fuzz_next() % 0x80 : fuzz_next();
+}
+
+static void fuzz_generate(void) {
+    if (fuzz_seed_count && fuzz_next() % 2) {
+        fuzz_current = fuzz_seeds[fuzz_next() % fuzz_seed_count];
+    } else {
+        fuzz_current.data[0] = fuzz_next();
+        fuzz_current.size    = 1;
+    }
+    for (int mutations = fuzz_next() % 8 + 1; mutations; mutations--) {
+        size_t events = (fuzz_current.size - 1) / 3;
+        size_t at     = 1 + (events ? fuzz_next() % events : 0) * 3;
+        if (fuzz_current.size + 3 * 16 <= sizeof(fuzz_current.data) && fuzz_next() % 4) {
+            int count = fuzz_next() % 16 + 1;
+            memmove(fuzz_current.data + at + 3 * count, fuzz_current.data + at,
+                    fuzz_current.size - at);
+            for (int i = 0; i < count; i++) {
+                fuzz_random_event(fuzz_current.data + at + 3 * i);
+            }
+            fuzz_current.size += 3 * count;
+        } else if (events) {
+            memmove(fuzz_current.data + at, fuzz_current.data + at + 3,
+                    fuzz_current.size - at - 3);
+            fuzz_current.size -= 3;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned long runs = 0;
+    unsigned long seed = time(NULL);
+    signal(SIGABRT, fuzz_crashed);
+    signal(SIGSEGV, fuzz_crashed);
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-runs=", 6) == 0) {
+            runs = strtoul(argv[i] + 6, NULL, 10);
+        } else if (strncmp(argv[i], "-seed=", 6) == 0) {
+            seed = strtoul(argv[i] + 6, NULL, 10);
+        }
+    }
+    clock_t start = clock();
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            fuzz_add(argv[i]);
+        }
+    }
+    fuzz_current_name = NULL;
+
+    fuzz_random = seed * 2654435761u + 1;
+    for (unsigned long run = 0; run < runs; run++) {
+        snprintf(fuzz_crash_name, sizeof(fuzz_crash_name), "crash-%lu-%lu", seed, run);
+        fuzz_generate();
+        fuzz_run();
+    }
+
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%zu inputs, %lu random, %lu events in %.1f s (%.0f events/s), seed %lu\n",
+           fuzz_seed_count, runs, fuzz_events, seconds, fuzz_events / (seconds > 0 ? seconds : 1),
+           seed);
+    return 0;
+}
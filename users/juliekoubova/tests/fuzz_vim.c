@@ -0,0 +1,106 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// libFuzzer target: arbitrary key streams through process_record_vim, with the
+// invariants checked after every key and task. The first byte picks the host,
+// then every event is three bytes:
+//
+//     key   index into fuzz_keys; each event presses or releases it in turn
+//     mods  0x80 | mods are QMK's one-shot mods during this event, in insert mode
+//     time  below 0x80, vim_task runs every ms for (time & 7) ms; from 0x80 the
+//           scan loop stalls for (time & 0x7F) * 40 ms, then runs once
+//
+// Held keys are released at the end of the input, and Vim mode must then have
+// given every key and mod it registered back. Only the direction of the last
+// search carries over to the next input.
+
+#include <stdlib.h>
+#include "harness.h"
+#include "vim.h"
+#include "vim/macro.h"
+#include "vim/repeat.h"
+
+static const uint16_t fuzz_keys[] = {
+    KC_A,      KC_B,       KC_C,            KC_D,          KC_E,          KC_F,      KC_G,
+    KC_H,      KC_I,       KC_J,            KC_K,          KC_L,          KC_M,      KC_N,
+    KC_O,      KC_P,       KC_Q,            KC_R,          KC_S,          KC_T,      KC_U,
+    KC_V,      KC_W,       KC_X,            KC_Y,          KC_Z,          KC_0,      KC_1,
+    KC_2,      KC_3,       KC_4,            KC_5,          KC_6,          KC_7,      KC_8,
+    KC_9,      KC_DOT,     KC_SCLN,         KC_SLASH,      KC_ENTER,      KC_ESCAPE, KC_BSPC,
+    KC_LSFT,   KC_LCTL,    KC_LALT,         KC_LEFT,       KC_TAB,        KC_F5,     QK_VIM,
+    MO(2),     LSFT(KC_4), LM(2, MOD_LSFT), OSM(MOD_LSFT), OSM(MOD_LCTL),
+};
+
+#define FUZZ_KEY_COUNT (sizeof(fuzz_keys) / sizeof(fuzz_keys[0]))
+
+static bool fuzz_held[FUZZ_KEY_COUNT];
+
+static void fuzz_check(void) {
+    if (harness_failures) {
+        abort();
+    }
+    harness_clear_log();
+}
+
+static void fuzz_event(const uint8_t *event) {
+    uint8_t key  = event[0] % FUZZ_KEY_COUNT;
+    uint8_t mods = event[1];
+    uint8_t time = event[2];
+
+    // QMK only has one-shot mods of its own while it gets the keys
+    if ((mods & 0x80) && VIM_PASSES_KEYS(vim_get_mode())) {
+        harness_set_oneshot_mods(mods & 0x0F);
+    }
+    fuzz_held[key] = !fuzz_held[key];
+    harness_key(fuzz_keys[key], fuzz_held[key]);
+    harness_set_oneshot_mods(0);
+    fuzz_check();
+
+    if (time < 0x80) {
+        harness_run(time & 7);
+    } else {
+        harness_advance((time & 0x7F) * 40);
+        harness_run(1);
+    }
+    fuzz_check();
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    // the same start every time, so that an input fails again on its own
+    vim_macro_forget();
+    vim_repeat_forget();
+    harness_advance((0x10000 - harness_now()) & 0xFFFF);
+    vim_set_host(data[0] % VIM_HOST_COUNT);
+    for (size_t i = 1; i + 3 <= size; i += 3) {
+        fuzz_event(data + i);
+    }
+
+    for (uint8_t key = 0; key < FUZZ_KEY_COUNT; key++) {
+        if (fuzz_held[key]) {
+            fuzz_held[key] = false;
+            harness_key(fuzz_keys[key], false);
+        }
+    }
+    harness_reset();
+    EXPECT(!has_anykey());
+    EXPECT(get_mods() == 0);
+    EXPECT(vim_get_mods() == 0);
+    fuzz_check();
+    return 0;
+}
@@ -0,0 +1,422 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "harness.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "vim.h"
+#include "vim/invariants.h"
+#include "vim/host.h"
+#include "vim/macro.h"
+#include "vim/recorder.h"
+#include "vim/vim_send.h"
+
+#define HARNESS_LOG_SIZE 8192
+
+char     harness_log[HARNESS_LOG_SIZE];
+uint16_t harness_reports      = 0;
+uint16_t harness_layer_writes = 0;
+uint16_t harness_failures     = 0;
+
+static size_t   harness_log_length = 0;
+static uint32_t harness_clock      = 0;
+static bool     harness_started    = false;
+
+static uint8_t harness_mods         = 0;
+static uint8_t harness_weak_mods    = 0;
+static uint8_t harness_oneshot_mods = 0;
+static bool    harness_keys[256];
+
+static void harness_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static void harness_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(harness_log + harness_log_length,
+                           sizeof(harness_log) - harness_log_length, format, args);
+    va_end(args);
+    if (length > 0 && harness_log_length + length < sizeof(harness_log)) {
+        harness_log_length += length;
+    }
+}
+
+// QMK
+
+bool               debug_enable        = false;
+layer_state_t      layer_state         = 0;
+layer_state_t      default_layer_state = 1;
+report_keyboard_t *keyboard_report     = &(report_keyboard_t){0};
+
+uint16_t timer_read(void) {
+    return harness_clock;
+}
+
+uint32_t timer_read32(void) {
+    return harness_clock;
+}
+
+uint16_t timer_elapsed(uint16_t last) {
+    return TIMER_DIFF_16(harness_clock, last);
+}
+
+uint32_t timer_elapsed32(uint32_t last) {
+    return TIMER_DIFF_32(harness_clock, last);
+}
+
+void wait_ms(uint16_t ms) {
+    harness_clock += ms;
+}
+
+void layer_state_set(layer_state_t state) {
+    layer_state = state;
+    harness_layer_writes++;
+}
+
+void layer_on(uint8_t layer) {
+    layer_state |= (layer_state_t)1 << layer;
+}
+
+void layer_off(uint8_t layer) {
+    layer_state &= ~((layer_state_t)1 << layer);
+}
+
+void send_keyboard_report(void) {
+    harness_reports++;
+}
+
+void register_code(uint8_t code) {
+    if (IS_MODIFIER_KEYCODE(code)) {
+        harness_mods |= MOD_BIT(code);
+    } else {
+        harness_keys[code] = true;
+    }
+    harness_printf("+%02x ", code);
+    send_keyboard_report();
+}
+
+void unregister_code(uint8_t code) {
+    if (IS_MODIFIER_KEYCODE(code)) {
+        harness_mods &= ~MOD_BIT(code);
+    } else {
+        harness_keys[code] = false;
+    }
+    harness_printf("-%02x ", code);
+    send_keyboard_report();
+}
+
+void register_mods(uint8_t mods) {
+    if (mods) {
+        harness_mods |= mods;
+        harness_printf("+m%x ", mods);
+        send_keyboard_report();
+    }
+}
+
+void unregister_mods(uint8_t mods) {
+    if (mods) {
+        harness_mods &= ~mods;
+        harness_printf("-m%x ", mods);
+        send_keyboard_report();
+    }
+}
+
+void add_mods(uint8_t mods) {
+    harness_mods |= mods;
+}
+
+void del_mods(uint8_t mods) {
+    harness_mods &= ~mods;
+}
+
+void set_mods(uint8_t mods) {
+    harness_mods = mods;
+}
+
+void clear_mods(void) {
+    harness_mods = 0;
+}
+
+uint8_t get_mods(void) {
+    return harness_mods;
+}
+
+uint8_t get_weak_mods(void) {
+    return harness_weak_mods;
+}
+
+void clear_weak_mods(void) {
+    harness_weak_mods = 0;
+}
+
+uint8_t get_oneshot_mods(void) {
+    return harness_oneshot_mods;
+}
+
+void del_oneshot_mods(uint8_t mods) {
+    harness_oneshot_mods &= ~mods;
+}
+
+void clear_oneshot_mods(void) {
+    harness_oneshot_mods = 0;
+}
+
+void clear_keyboard_but_mods(void) {
+    harness_weak_mods = 0;
+    memset(harness_keys, 0, sizeof(harness_keys));
+    harness_printf("CLK ");
+    send_keyboard_report();
+}
+
+void clear_keyboard(void) {
+    harness_mods      = 0;
+    harness_weak_mods = 0;
+    memset(harness_keys, 0, sizeof(harness_keys));
+    harness_printf("CLR ");
+    send_keyboard_report();
+}
+
+uint8_t has_anykey(void) {
+    for (size_t code = 0; code < sizeof(harness_keys); code++) {
+        if (harness_keys[code]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void host_mouse_send(report_mouse_t *report) {
+    harness_printf("W%d ", report->v);
+}
+
+bool is_caps_word_on(void) {
+    return false;
+}
+
+void caps_word_off(void) {}
+
+static uint32_t harness_eeconfig_user = 0;
+static uint8_t  harness_eeconfig_datablock[1024];
+
+uint32_t eeconfig_read_user(void) {
+    return harness_eeconfig_user;
+}
+
+void eeconfig_update_user(uint32_t value) {
+    harness_eeconfig_user = value;
+}
+
+void eeconfig_read_user_datablock(void *data, uint32_t offset, uint32_t length) {
+    memcpy(data, harness_eeconfig_datablock + offset, length);
+}
+
+void eeconfig_update_user_datablock(const void *data, uint32_t offset, uint32_t length) {
+    memcpy(harness_eeconfig_datablock + offset, data, length);
+}
+
+#ifdef VIM_DEBUG_INVARIANTS
+void vim_invariant_failed(vim_invariant_t invariant) {
+    printf("invariant %d broken at %lu ms, after: %s\n", invariant,
+           (unsigned long)harness_clock, harness_log);
+    harness_failures++;
+}
+#endif
+
+// Tests
+
+static void harness_start(void) {
+    if (!harness_started) {
+        harness_started = true;
+        vim_init();
+    }
+}
+
+static uint8_t harness_mod_bits(uint8_t mods) {
+    return (mods & 0x10) ? (mods & 0x0f) << 4 : mods;
+}
+
+// What QMK does with the keys let through. One-shot mods are taken to be
+// held, a test that needs them tapped sets them itself.
+static void harness_qmk_key(uint16_t keycode, bool pressed) {
+    if (IS_QK_BASIC(keycode) && keycode != KC_NO) {
+        if (pressed) {
+            register_code(keycode);
+        } else {
+            unregister_code(keycode);
+        }
+    } else if (IS_QK_MODS(keycode)) {
+        uint8_t mods = harness_mod_bits(QK_MODS_GET_MODS(keycode));
+        if (pressed) {
+            harness_weak_mods |= mods;
+            register_code(QK_MODS_GET_BASIC_KEYCODE(keycode));
+        } else {
+            unregister_code(QK_MODS_GET_BASIC_KEYCODE(keycode));
+            harness_weak_mods &= ~mods;
+        }
+    } else if (IS_QK_MOMENTARY(keycode)) {
+        if (pressed) {
+            layer_on(QK_MOMENTARY_GET_LAYER(keycode));
+        } else {
+            layer_off(QK_MOMENTARY_GET_LAYER(keycode));
+        }
+    } else if (IS_QK_LAYER_MOD(keycode)) {
+        uint8_t mods = harness_mod_bits(QK_LAYER_MOD_GET_MODS(keycode));
+        if (pressed) {
+            layer_on(QK_LAYER_MOD_GET_LAYER(keycode));
+            register_mods(mods);
+        } else {
+            layer_off(QK_LAYER_MOD_GET_LAYER(keycode));
+            unregister_mods(mods);
+        }
+    } else if (IS_QK_ONE_SHOT_MOD(keycode)) {
+        uint8_t mods = harness_mod_bits(QK_ONE_SHOT_MOD_GET_MODS(keycode));
+        if (pressed) {
+            register_mods(mods);
+        } else {
+            unregister_mods(mods);
+        }
+    }
+}
+
+static bool harness_record(uint16_t keycode, bool pressed, uint8_t tap_count) {
+    harness_start();
+    keyrecord_t record = {
+        .event   = {.pressed = pressed, .time = timer_read()},
+        .tap     = {.count = tap_count},
+        .keycode = keycode,
+    };
+    bool result = process_record_vim(keycode, &record, QK_VIM);
+    if (result) {
+        harness_qmk_key(keycode, pressed);
+    }
+    return result;
+}
+
+bool harness_key(uint16_t keycode, bool pressed) {
+    return harness_record(keycode, pressed, 0);
+}
+
+void harness_tap(uint16_t keycode) {
+    harness_key(keycode, true);
+    harness_key(keycode, false);
+}
+
+void harness_advance(uint32_t ms) {
+    harness_clock += ms;
+}
+
+uint32_t harness_now(void) {
+    return harness_clock;
+}
+
+void harness_run(uint32_t ms) {
+    harness_start();
+    while (ms--) {
+        harness_clock++;
+        vim_task();
+    }
+}
+
+static uint16_t harness_read16(const uint8_t *bytes) {
+    return bytes[0] | bytes[1] << 8;
+}
+
+bool harness_replay(const uint8_t *dump, uint16_t size) {
+    // the header is the magic, the count, the host and mode, and the dropped
+    if (size < 8 || harness_read16(dump) != 0x5256 || size < 8 + harness_read16(dump + 2) * 4) {
+        return false;
+    }
+    uint16_t count = harness_read16(dump + 2);
+    for (const uint8_t *event = dump + 8; count--; event += 4) {
+        uint16_t header = harness_read16(event);
+        uint16_t value  = harness_read16(event + 2);
+        harness_run(header & 0xfff);
+        switch (header >> 12) {
+            case VIM_RECORD_KEY_UP:
+            case VIM_RECORD_KEY_DOWN:
+                harness_record(value, header >> 12 == VIM_RECORD_KEY_DOWN, 0);
+                break;
+            case VIM_RECORD_TAP_UP:
+            case VIM_RECORD_TAP_DOWN:
+                harness_record(value, header >> 12 == VIM_RECORD_TAP_DOWN, 1);
+                break;
+            case VIM_RECORD_HOST:
+                // set by a key again anyway, or from outside, e.g. OS detection
+                if (value != vim_get_host()) {
+                    vim_set_host(value);
+                }
+                break;
+        }
+    }
+    return true;
+}
+
+void harness_reset(void) {
+    harness_start();
+    if (vim_get_mode() != VIM_MODE_INSERT) {
+        vim_enter_insert_mode();
+    }
+    // drain what is queued, then jump past the pending timeout
+    for (uint16_t ms = 0; (vim_send_busy() || vim_macro_is_playing()) && ms < 5000; ms++) {
+        harness_run(1);
+    }
+    harness_advance(5000);
+    harness_run(1);
+    harness_oneshot_mods = 0;
+    harness_weak_mods    = 0;
+    harness_clear_log();
+}
+
+void harness_clear_log(void) {
+    harness_log_length   = 0;
+    harness_log[0]       = '\0';
+    harness_reports      = 0;
+    harness_layer_writes = 0;
+}
+
+void harness_set_oneshot_mods(uint8_t mods) {
+    harness_oneshot_mods = mods;
+}
+
+void harness_set_weak_mods(uint8_t mods) {
+    harness_weak_mods = mods;
+}
+
+bool harness_is_key_down(uint8_t code) {
+    return harness_keys[code];
+}
+
+void harness_expect(bool ok, const char *file, int line, const char *what) {
+    if (!ok) {
+        printf("%s:%d: expected %s\n", file, line, what);
+        harness_failures++;
+    }
+}
+
+void harness_expect_log(const char *expected, const char *file, int line) {
+    if (strcmp(harness_log, expected) != 0) {
+        printf("%s:%d: expected \"%s\", sent \"%s\"\n", file, line, expected, harness_log);
+        harness_failures++;
+    }
+    harness_clear_log();
+}
+
+int harness_done(void) {
+    if (harness_failures) {
+        printf("%u failed\n", harness_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs Vim mode on the host, on top of the QMK functions stubbed in harness.c
+// and a virtual clock that only moves when a test says so.
+//
+// Whatever Vim mode sends to the host is appended to harness_log: `+04` and
+// `-04` press and release KC_A, `+m2` and `-m2` the left Shift, `CLR` and
+// `CLK` are clear_keyboard and clear_keyboard_but_mods, and `W3` scrolls the
+// wheel three detents up.
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "quantum/quantum.h"
+
+// the key that toggles Vim mode in the tests
+#define QK_VIM SAFE_RANGE
+
+extern char     harness_log[];
+extern uint16_t harness_reports;
+extern uint16_t harness_layer_writes;
+extern uint16_t harness_failures;
+
+// process_record_vim for a key, and both of its events. A key that Vim mode
+// lets through then does what it would in QMK: basic keys, LSFT(), MO(), LM()
+// and OSM() are understood.
+bool harness_key(uint16_t keycode, bool pressed);
+void harness_tap(uint16_t keycode);
+
+// Moves the clock without running vim_task, e.g. to test the timer wheel on
+// its own, or to pretend the scan loop was stalled.
+void     harness_advance(uint32_t ms);
+uint32_t harness_now(void);
+
+// Runs vim_task every millisecond for this long.
+void harness_run(uint32_t ms);
+
+// Feeds the keys of a VIM_RECORDER dump back in, at the times they were
+// recorded, with vim_task run every millisecond in between. Host changes from
+// outside are replayed too, everything else is what the keys do. False if
+// this isn't a dump.
+bool harness_replay(const uint8_t *dump, uint16_t size);
+
+// Leaves Vim mode, waits for everything in flight, and forgets what was sent.
+void harness_reset(void);
+void harness_clear_log(void);
+
+void harness_set_oneshot_mods(uint8_t mods);
+void harness_set_weak_mods(uint8_t mods);
+bool harness_is_key_down(uint8_t code);
+
+void harness_expect(bool ok, const char *file, int line, const char *what);
+void harness_expect_log(const char *expected, const char *file, int line);
+int  harness_done(void);
+
+#define EXPECT(cond) harness_expect((cond), __FILE__, __LINE__, #cond)
+
+// Compares the log with what was expected, and clears it.
+#define EXPECT_LOG(expected) harness_expect_log((expected), __FILE__, __LINE__)
@@ -0,0 +1,224 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The keycodes Vim mode and the tests use, with QMK's values.
+
+#pragma once
+#include <stdint.h>
+
+enum {
+    KC_NO   = 0x00,
+    KC_TRNS = 0x01,
+    KC_A    = 0x04,
+    KC_B,
+    KC_C,
+    KC_D,
+    KC_E,
+    KC_F,
+    KC_G,
+    KC_H,
+    KC_I,
+    KC_J,
+    KC_K,
+    KC_L,
+    KC_M,
+    KC_N,
+    KC_O,
+    KC_P,
+    KC_Q,
+    KC_R,
+    KC_S,
+    KC_T,
+    KC_U,
+    KC_V,
+    KC_W,
+    KC_X,
+    KC_Y,
+    KC_Z,
+    KC_1,
+    KC_2,
+    KC_3,
+    KC_4,
+    KC_5,
+    KC_6,
+    KC_7,
+    KC_8,
+    KC_9,
+    KC_0,
+    KC_ENTER,
+    KC_ESCAPE,
+    KC_BACKSPACE,
+    KC_TAB,
+    KC_SPACE,
+    KC_MINUS,
+    KC_EQUAL,
+    KC_LEFT_BRACKET,
+    KC_RIGHT_BRACKET,
+    KC_BACKSLASH,
+    KC_NONUS_HASH,
+    KC_SEMICOLON,
+    KC_QUOTE,
+    KC_GRAVE,
+    KC_COMMA,
+    KC_DOT,
+    KC_SLASH,
+    KC_CAPS_LOCK,
+    KC_F1,
+    KC_F2,
+    KC_F3,
+    KC_F4,
+    KC_F5,
+    KC_F6,
+    KC_F7,
+    KC_F8,
+    KC_F9,
+    KC_F10,
+    KC_F11,
+    KC_F12,
+    KC_PRINT_SCREEN,
+    KC_SCROLL_LOCK,
+    KC_PAUSE,
+    KC_INSERT,
+    KC_HOME,
+    KC_PAGE_UP,
+    KC_DELETE,
+    KC_END,
+    KC_PAGE_DOWN,
+    KC_RIGHT,
+    KC_LEFT,
+    KC_DOWN,
+    KC_UP,
+    KC_F13           = 0x68,
+    KC_F24           = 0x73,
+    KC_EXSEL         = 0xA4,
+    KC_SYSTEM_POWER  = 0xA5,
+    KC_AUDIO_MUTE    = 0xA8,
+    KC_LAUNCHPAD     = 0xC2,
+    KC_MS_UP         = 0xCD,
+    KC_MS_ACCEL2     = 0xDF,
+    KC_LEFT_CTRL     = 0xE0,
+    KC_LEFT_SHIFT,
+    KC_LEFT_ALT,
+    KC_LEFT_GUI,
+    KC_RIGHT_CTRL,
+    KC_RIGHT_SHIFT,
+    KC_RIGHT_ALT,
+    KC_RIGHT_GUI,
+};
+
+#define KC_ENT KC_ENTER
+#define KC_ESC KC_ESCAPE
+#define KC_BSPC KC_BACKSPACE
+#define KC_SPC KC_SPACE
+#define KC_MINS KC_MINUS
+#define KC_EQL KC_EQUAL
+#define KC_LBRC KC_LEFT_BRACKET
+#define KC_RBRC KC_RIGHT_BRACKET
+#define KC_BSLS KC_BACKSLASH
+#define KC_SCLN KC_SEMICOLON
+#define KC_QUOT KC_QUOTE
+#define KC_GRV KC_GRAVE
+#define KC_COMM KC_COMMA
+#define KC_SLSH KC_SLASH
+#define KC_DEL KC_DELETE
+#define KC_PGUP KC_PAGE_UP
+#define KC_PGDN KC_PAGE_DOWN
+#define KC_LCTL KC_LEFT_CTRL
+#define KC_LSFT KC_LEFT_SHIFT
+#define KC_LALT KC_LEFT_ALT
+#define KC_LGUI KC_LEFT_GUI
+#define KC_RCTL KC_RIGHT_CTRL
+#define KC_RSFT KC_RIGHT_SHIFT
+#define KC_RALT KC_RIGHT_ALT
+#define KC_RGUI KC_RIGHT_GUI
+
+#define QK_BASIC 0x0000
+#define QK_BASIC_MAX 0x00FF
+#define QK_MODS 0x0100
+#define QK_MODS_MAX 0x1FFF
+#define QK_LCTL 0x0100
+#define QK_LSFT 0x0200
+#define QK_LALT 0x0400
+#define QK_LGUI 0x0800
+#define QK_RMODS_MIN 0x1000
+#define QK_MOD_TAP 0x2000
+#define QK_MOD_TAP_MAX 0x3FFF
+#define QK_LAYER_TAP 0x4000
+#define QK_LAYER_TAP_MAX 0x4FFF
+#define QK_LAYER_MOD 0x5000
+#define QK_LAYER_MOD_MAX 0x51FF
+#define QK_TO 0x5200
+#define QK_TO_MAX 0x521F
+#define QK_MOMENTARY 0x5220
+#define QK_MOMENTARY_MAX 0x523F
+#define QK_DEF_LAYER 0x5240
+#define QK_DEF_LAYER_MAX 0x525F
+#define QK_TOGGLE_LAYER 0x5260
+#define QK_TOGGLE_LAYER_MAX 0x527F
+#define QK_ONE_SHOT_LAYER 0x5280
+#define QK_ONE_SHOT_LAYER_MAX 0x529F
+#define QK_ONE_SHOT_MOD 0x52A0
+#define QK_ONE_SHOT_MOD_MAX 0x52BF
+#define QK_LAYER_TAP_TOGGLE 0x52C0
+#define QK_LAYER_TAP_TOGGLE_MAX 0x52DF
+#define QK_BOOT 0x7C00
+#define SAFE_RANGE 0x7E40
+
+#define IS_QK_BASIC(code) ((code) >= QK_BASIC && (code) <= QK_BASIC_MAX)
+#define IS_QK_MODS(code) ((code) >= QK_MODS && (code) <= QK_MODS_MAX)
+#define IS_QK_MOD_TAP(code) ((code) >= QK_MOD_TAP && (code) <= QK_MOD_TAP_MAX)
+#define IS_QK_LAYER_TAP(code) ((code) >= QK_LAYER_TAP && (code) <= QK_LAYER_TAP_MAX)
+#define IS_QK_LAYER_MOD(code) ((code) >= QK_LAYER_MOD && (code) <= QK_LAYER_MOD_MAX)
+#define IS_QK_TO(code) ((code) >= QK_TO && (code) <= QK_TO_MAX)
+#define IS_QK_MOMENTARY(code) ((code) >= QK_MOMENTARY && (code) <= QK_MOMENTARY_MAX)
+#define IS_QK_DEF_LAYER(code) ((code) >= QK_DEF_LAYER && (code) <= QK_DEF_LAYER_MAX)
+#define IS_QK_TOGGLE_LAYER(code) ((code) >= QK_TOGGLE_LAYER && (code) <= QK_TOGGLE_LAYER_MAX)
+#define IS_QK_ONE_SHOT_LAYER(code) ((code) >= QK_ONE_SHOT_LAYER && (code) <= QK_ONE_SHOT_LAYER_MAX)
+#define IS_QK_ONE_SHOT_MOD(code) ((code) >= QK_ONE_SHOT_MOD && (code) <= QK_ONE_SHOT_MOD_MAX)
+#define IS_QK_LAYER_TAP_TOGGLE(code) ((code) >= QK_LAYER_TAP_TOGGLE && (code) <= QK_LAYER_TAP_TOGGLE_MAX)
+#define IS_BASIC_KEYCODE(code) ((code) >= KC_A && (code) <= KC_EXSEL)
+#define IS_MODIFIER_KEYCODE(code) ((code) >= KC_LEFT_CTRL && (code) <= KC_RIGHT_GUI)
+
+#define QK_MODS_GET_MODS(kc) (((kc) >> 8) & 0x1F)
+#define QK_MODS_GET_BASIC_KEYCODE(kc) ((kc) & 0xFF)
+#define QK_MOD_TAP_GET_MODS(kc) (((kc) >> 8) & 0x1F)
+#define QK_MOD_TAP_GET_TAP_KEYCODE(kc) ((kc) & 0xFF)
+#define QK_LAYER_TAP_GET_TAP_KEYCODE(kc) ((kc) & 0xFF)
+#define QK_MOMENTARY_GET_LAYER(kc) ((kc) & 0x1F)
+#define QK_LAYER_MOD_GET_LAYER(kc) (((kc) >> 5) & 0xF)
+#define QK_LAYER_MOD_GET_MODS(kc) ((kc) & 0x1F)
+#define QK_ONE_SHOT_MOD_GET_MODS(kc) ((kc) & 0x1F)
+
+#define LCTL(kc) (QK_LCTL | (kc))
+#define LSFT(kc) (QK_LSFT | (kc))
+#define LALT(kc) (QK_LALT | (kc))
+#define LGUI(kc) (QK_LGUI | (kc))
+#define LCA(kc) (QK_LCTL | QK_LALT | (kc))
+#define LSA(kc) (QK_LSFT | QK_LALT | (kc))
+#define RCS(kc) (QK_RMODS_MIN | QK_LCTL | QK_LSFT | (kc))
+#define LM(layer, mod) (QK_LAYER_MOD | ((layer) & 0xF) << 5 | ((mod) & 0x1F))
+#define OSM(mod) (QK_ONE_SHOT_MOD | ((mod) & 0x1F))
+#define MO(layer) (QK_MOMENTARY | ((layer) & 0x1F))
+
+#define MOD_LCTL 0x01
+#define MOD_LSFT 0x02
+#define MOD_LALT 0x04
+#define MOD_LGUI 0x08
+#define MOD_BIT(code) (1 << ((code) & 0x07))
+#define MOD_MASK_CTRL (MOD_BIT(KC_LCTL) | MOD_BIT(KC_RCTL))
+#define MOD_MASK_SHIFT (MOD_BIT(KC_LSFT) | MOD_BIT(KC_RSFT))
+#define MOD_MASK_ALT (MOD_BIT(KC_LALT) | MOD_BIT(KC_RALT))
+#define MOD_MASK_GUI (MOD_BIT(KC_LGUI) | MOD_BIT(KC_RGUI))
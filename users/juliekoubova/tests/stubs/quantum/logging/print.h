@@ -0,0 +1,36 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdio.h>
+
+extern bool debug_enable;
+
+#define print(s) printf("%s", s)
+#define dprint(s)            \
+    do {                     \
+        if (debug_enable) {  \
+            printf("%s", s); \
+        }                    \
+    } while (0)
+#define dprintf(...)             \
+    do {                         \
+        if (debug_enable) {      \
+            printf(__VA_ARGS__); \
+        }                        \
+    } while (0)
+#define xprintf printf
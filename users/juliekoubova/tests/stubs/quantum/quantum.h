@@ -0,0 +1,111 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Just enough of QMK's quantum.h for Vim mode to build and run on the host.
+// The functions are implemented in harness.c.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "quantum/keycode.h"
+#include "quantum/logging/print.h"
+#include "platforms/timer.h"
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define memcpy_P memcpy
+
+typedef struct {
+    uint8_t col;
+    uint8_t row;
+} keypos_t;
+
+typedef struct {
+    keypos_t key;
+    uint16_t time;
+    uint8_t  type;
+    bool     pressed;
+} keyevent_t;
+
+typedef struct {
+    bool    interrupted : 1;
+    bool    reserved2 : 1;
+    bool    reserved1 : 1;
+    bool    reserved0 : 1;
+    uint8_t count : 4;
+} tap_t;
+
+typedef struct {
+    keyevent_t event;
+    tap_t      tap;
+    uint16_t   keycode;
+} keyrecord_t;
+
+typedef struct {
+    uint8_t mods;
+    uint8_t reserved;
+    uint8_t keys[6];
+} report_keyboard_t;
+
+typedef struct {
+    uint8_t buttons;
+    int8_t  x;
+    int8_t  y;
+    int8_t  v;
+    int8_t  h;
+} report_mouse_t;
+
+typedef uint32_t layer_state_t;
+
+extern layer_state_t      layer_state;
+extern layer_state_t      default_layer_state;
+extern report_keyboard_t *keyboard_report;
+
+void layer_state_set(layer_state_t state);
+void layer_on(uint8_t layer);
+void layer_off(uint8_t layer);
+
+void    register_code(uint8_t code);
+void    unregister_code(uint8_t code);
+void    register_mods(uint8_t mods);
+void    unregister_mods(uint8_t mods);
+void    add_mods(uint8_t mods);
+void    del_mods(uint8_t mods);
+void    set_mods(uint8_t mods);
+void    clear_mods(void);
+uint8_t get_mods(void);
+uint8_t get_weak_mods(void);
+void    clear_weak_mods(void);
+uint8_t get_oneshot_mods(void);
+void    del_oneshot_mods(uint8_t mods);
+void    clear_oneshot_mods(void);
+void    clear_keyboard(void);
+void    clear_keyboard_but_mods(void);
+uint8_t has_anykey(void);
+void    send_keyboard_report(void);
+void    host_mouse_send(report_mouse_t *report);
+
+bool is_caps_word_on(void);
+void caps_word_off(void);
+
+void wait_ms(uint16_t ms);
+
+uint32_t eeconfig_read_user(void);
+void     eeconfig_update_user(uint32_t value);
+void     eeconfig_read_user_datablock(void *data, uint32_t offset, uint32_t length);
+void     eeconfig_update_user_datablock(const void *data, uint32_t offset, uint32_t length);
@@ -0,0 +1,60 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The host remembered in the EECONFIG user datablock, with VIM_HOST_EEPROM.
+
+#include "harness.h"
+#include "vim.h"
+#include "vim/eeprom.h"
+#include "vim/host.h"
+
+static uint8_t saved_host(void) {
+    uint8_t host;
+    eeconfig_read_user_datablock(&host, VIM_EEPROM_HOST_OFFSET, sizeof(host));
+    return host;
+}
+
+static void boot_with(uint8_t host) {
+    vim_set_host(VIM_HOST_WINDOWS);
+    eeconfig_update_user_datablock(&host, VIM_EEPROM_HOST_OFFSET, sizeof(host));
+    vim_host_init();
+}
+
+static void test_saved(void) {
+    eeconfig_update_user(0x12345678);
+    vim_set_host(VIM_HOST_MAC);
+    EXPECT(saved_host() == (0xA0 | VIM_HOST_MAC));
+    // the user word belongs to the keymap
+    EXPECT(eeconfig_read_user() == 0x12345678);
+
+    boot_with(0xA0 | VIM_HOST_LINUX);
+    EXPECT(vim_get_host() == VIM_HOST_LINUX);
+}
+
+static void test_not_a_host(void) {
+    // blank EEPROM, a bare host number, out of range, erased flash
+    static const uint8_t bytes[] = {0x00, VIM_HOST_MAC, 0xA0 | VIM_HOST_COUNT, 0xFF};
+    for (uint8_t i = 0; i < sizeof(bytes); i++) {
+        boot_with(bytes[i]);
+        EXPECT(vim_get_host() == VIM_HOST_WINDOWS);
+    }
+}
+
+int main(void) {
+    test_saved();
+    test_not_a_host();
+    return harness_done();
+}
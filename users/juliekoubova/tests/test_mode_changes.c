@@ -0,0 +1,114 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// How many reports each mode change sends, and how often vim_mode_changed is
+// called. The counts before mode changes were sent as a diff are noted with
+// each step.
+
+#include <stdio.h>
+#include "harness.h"
+#include "vim.h"
+
+static uint16_t notified;
+
+void vim_mode_changed(vim_mode_t mode) {
+    notified++;
+}
+
+static void step(const char *label, uint16_t reports, uint16_t notifications) {
+    harness_run(500);
+    printf("  %-26s reports=%-2u notified=%u\n", label, harness_reports, notified);
+    EXPECT(harness_reports == reports);
+    EXPECT(notified == notifications);
+    EXPECT(harness_layer_writes == 0);
+    harness_clear_log();
+    notified = 0;
+}
+
+static void test_mode_changes(void) {
+    harness_reset();
+    notified = 0;
+
+    harness_tap(QK_VIM);
+    step("insert -> command", 0, 1); // was 1 report
+    harness_tap(KC_V);
+    step("command -> visual", 0, 1); // was 1
+    harness_tap(KC_ESCAPE);
+    step("visual -> command", 0, 1); // was 3
+    harness_tap(KC_I);
+    step("command -> insert", 1, 1); // the release of `i`, was 2
+
+    harness_key(KC_LSFT, true);
+    harness_tap(QK_VIM);
+    step("insert -> command, Shift", 2, 1); // Shift, and taking it off the host
+    harness_key(KC_LSFT, false);
+    harness_key(KC_LSFT, true);
+    harness_tap(KC_I);
+    harness_key(KC_LSFT, false);
+    step("command -> insert, Shift", 5, 1); // was 6
+
+    harness_tap(QK_VIM);
+    step("insert -> command", 0, 1); // was 1
+    harness_tap(KC_C);
+    harness_tap(KC_W);
+    step("cw", 9, 1); // was 10
+    harness_tap(KC_X);
+    harness_tap(QK_VIM);
+    step("x, insert -> command", 2, 1); // was 3
+    harness_tap(KC_DOT);
+    step(".", 10, 0); // was 12, and notified twice
+}
+
+static void test_oneshot_commands(void) {
+    harness_reset();
+    notified = 0;
+
+    // typed, it doesn't leave the fast path
+    EXPECT(!vim_slow_path && !vim_may_be_oneshot_chord(KC_O));
+    harness_tap(KC_O);
+    step("o", 2, 0);
+
+    harness_key(KC_LCTL, true);
+    EXPECT(vim_may_be_oneshot_chord(KC_O));
+    harness_tap(KC_O);
+    harness_key(KC_LCTL, false);
+    // Ctrl, and taking it off the host. The release of `o` goes to the host
+    // like any key pressed before the mode change.
+    step("Ctrl+O", 3, 1);
+    harness_tap(KC_W);
+    step("w, command -> insert", 4, 1); // just Ctrl+Right
+
+    harness_key(KC_LCTL, true);
+    harness_tap(KC_O);
+    harness_key(KC_LCTL, false);
+    harness_tap(KC_D);
+    harness_tap(KC_W);
+    step("Ctrl+O dw", 11, 2);
+
+    // a one-shot Ctrl is used up by the chord, `w` is a plain word motion
+    harness_set_oneshot_mods(MOD_BIT(KC_LCTL));
+    harness_tap(KC_O);
+    EXPECT(vim_get_mode() == VIM_MODE_COMMAND && get_oneshot_mods() == 0);
+    harness_tap(KC_W);
+    EXPECT(vim_get_mode() == VIM_MODE_INSERT);
+    step("OSM(Ctrl) o w", 4, 2);
+}
+
+int main(void) {
+    test_mode_changes();
+    test_oneshot_commands();
+    return harness_done();
+}
@@ -0,0 +1,60 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The keys let through to the host, per host profile.
+
+#include "harness.h"
+#include "vim.h"
+
+// the Mac doesn't get the F-keys in the visual modes
+#define MAC_VISUAL(i) VIM_PASSTHROUGH_RANGE(i, KC_MS_UP, KC_MS_ACCEL2)
+const uint8_t mac_visual[32] PROGMEM = VIM_PASSTHROUGH_TABLE(MAC_VISUAL);
+
+static void visual_mode(vim_host_t host) {
+    harness_reset();
+    vim_set_host(host);
+    harness_tap(QK_VIM);
+    harness_tap(KC_V);
+    harness_run(100);
+    harness_clear_log();
+}
+
+static void test_default(void) {
+    visual_mode(VIM_HOST_WINDOWS);
+    harness_tap(KC_F5);
+    harness_run(100);
+    EXPECT_LOG("+3e -3e ");
+}
+
+static void test_profile_table(void) {
+    visual_mode(VIM_HOST_MAC);
+    harness_tap(KC_F5);
+    harness_run(100);
+    EXPECT_LOG("");
+    EXPECT(vim_get_mode() == VIM_MODE_VISUAL);
+
+    // command mode keeps the default
+    harness_tap(KC_ESCAPE);
+    harness_tap(KC_F5);
+    harness_run(100);
+    EXPECT_LOG("+3e -3e ");
+}
+
+int main(void) {
+    test_default();
+    test_profile_table();
+    return harness_done();
+}
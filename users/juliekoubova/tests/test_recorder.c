@@ -0,0 +1,115 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// A VIM_RECORDER dump played back through harness_replay records the same
+// dump again, bit for bit.
+
+#include <string.h>
+#include "harness.h"
+#include "vim.h"
+#include "vim/macro.h"
+#include "vim/recorder.h"
+#include "vim/repeat.h"
+
+#define DUMP_SIZE (8 + VIM_RECORDER_SIZE * 4)
+
+static uint8_t recorded[DUMP_SIZE];
+static uint8_t replayed[DUMP_SIZE];
+
+// the way the host tool reads it, a raw HID report at a time
+static uint16_t read_dump(uint8_t *dump) {
+    uint16_t size = 8;
+    for (uint16_t offset = 0; offset < size; offset += 29) {
+        uint8_t report[32] = {0x77, offset & 0xff, offset >> 8};
+        EXPECT(vim_recorder_raw_hid(report, sizeof(report)));
+        memcpy(dump + offset, report + 3, 29);
+        size = 8 + (dump[2] | dump[3] << 8) * 4;
+    }
+    return size;
+}
+
+static void start(vim_host_t host) {
+    harness_reset();
+    vim_macro_forget();
+    vim_repeat_forget();
+    vim_set_host(host);
+    vim_recorder_clear();
+}
+
+static void tap(uint16_t keycode, uint32_t hold, uint32_t gap) {
+    harness_key(keycode, true);
+    harness_run(hold);
+    harness_key(keycode, false);
+    harness_run(gap);
+}
+
+static void session(void) {
+    tap(KC_H, 30, 80);
+    tap(LSFT(KC_4), 40, 60);
+    tap(QK_VIM, 20, 100);
+    // dw, 3j, then c2w and `.` typed while the cut is still being sent
+    tap(KC_D, 25, 10);
+    tap(KC_W, 25, 200);
+    tap(KC_3, 15, 20);
+    tap(KC_J, 15, 300);
+    tap(KC_C, 10, 0);
+    tap(KC_2, 10, 0);
+    tap(KC_W, 10, 0);
+    tap(KC_X, 10, 0);
+    tap(QK_VIM, 10, 0);
+    tap(KC_DOT, 10, 500);
+    // v$y with Shift held, then a host change from outside
+    tap(KC_V, 30, 40);
+    harness_key(KC_LSFT, true);
+    tap(KC_4, 30, 20);
+    harness_key(KC_LSFT, false);
+    tap(KC_Y, 30, 400);
+    vim_set_host(VIM_HOST_MAC);
+    tap(KC_B, 20, 5000);
+    tap(KC_I, 20, 100);
+    tap(KC_Z, 20, 100);
+}
+
+static void test_round_trip(vim_host_t host) {
+    start(host);
+    session();
+    uint16_t size = read_dump(recorded);
+    // the sends as well as the keys, and nothing overwritten
+    EXPECT(size > 8 + 60 * 4);
+    EXPECT(recorded[6] == 0 && recorded[7] == 0);
+
+    start(host);
+    EXPECT(harness_replay(recorded, size));
+    EXPECT(read_dump(replayed) == size);
+    EXPECT(memcmp(recorded, replayed, size) == 0);
+}
+
+static void test_not_a_dump(void) {
+    start(VIM_HOST_WINDOWS);
+    session();
+    uint16_t size = read_dump(recorded);
+    recorded[0] ^= 1;
+    EXPECT(!harness_replay(recorded, size));
+    recorded[0] ^= 1;
+    EXPECT(!harness_replay(recorded, size - 1));
+}
+
+int main(void) {
+    test_round_trip(VIM_HOST_WINDOWS);
+    test_round_trip(VIM_HOST_LINUX);
+    test_not_a_dump();
+    return harness_done();
+}
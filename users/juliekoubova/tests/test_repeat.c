@@ -0,0 +1,126 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// What `.` replays.
+
+#include "harness.h"
+
+// Ctrl+Shift+Right selects the word, Ctrl+X cuts it
+#define CUT_WORD "+m3 +4f -4f -m3 +m1 +1b -1b -m1 "
+// Ctrl+Right and Ctrl+Left find the start of the word first, Shift+Left leaves
+// out the space after it
+#define CUT_INNER_WORD \
+    "+m1 +4f -4f -m1 +m1 +50 -50 -m1 +m3 +4f -4f -m3 +m2 +50 -50 -m2 +m1 +1b -1b -m1 "
+
+static void command_mode(void) {
+    harness_reset();
+    harness_tap(QK_VIM);
+    harness_run(100);
+    harness_clear_log();
+}
+
+static void test_change_word(void) {
+    command_mode();
+    // typed right away, while the cut is still being sent
+    harness_tap(KC_C);
+    harness_tap(KC_W);
+    harness_tap(KC_X);
+    harness_tap(KC_Y);
+    harness_tap(QK_VIM);
+    harness_run(500);
+    // `w` is released in insert mode already, that goes to the host
+    EXPECT_LOG(CUT_WORD "-1a +1b -1b +1c -1c ");
+
+    harness_tap(KC_DOT);
+    harness_run(500);
+    EXPECT_LOG(CUT_WORD "+1b -1b +1c -1c ");
+}
+
+static void test_change_inner_word(void) {
+    command_mode();
+    harness_tap(KC_C);
+    harness_tap(KC_I);
+    harness_tap(KC_W);
+    harness_tap(KC_X);
+    harness_tap(KC_Y);
+    harness_tap(QK_VIM);
+    harness_run(500);
+    harness_clear_log();
+
+    harness_tap(KC_DOT);
+    harness_run(500);
+    EXPECT_LOG(CUT_INNER_WORD "+1b -1b +1c -1c ");
+}
+
+static void test_delete_around_paragraph(void) {
+    command_mode();
+    harness_tap(KC_D);
+    harness_tap(KC_A);
+    harness_tap(KC_P);
+    harness_run(500);
+    // Ctrl+Down Ctrl+Up, Ctrl+Shift+Down, Ctrl+X
+    EXPECT_LOG("+m1 +51 -51 -m1 +m1 +52 -52 -m1 +m3 +51 -51 -m3 +m1 +1b -1b -m1 ");
+
+    harness_tap(KC_2);
+    harness_tap(KC_DOT);
+    harness_run(500);
+    EXPECT_LOG("+m1 +51 -51 -m1 +m1 +52 -52 -m1 +m3 +51 -51 -m3 +m3 +51 -51 -m3 "
+               "+m1 +1b -1b -m1 ");
+}
+
+static void test_yank_keeps_last_change(void) {
+    command_mode();
+    harness_tap(KC_C);
+    harness_tap(KC_W);
+    harness_tap(KC_X);
+    harness_tap(QK_VIM);
+    harness_tap(KC_Y);
+    harness_tap(KC_I);
+    harness_tap(KC_P);
+    harness_run(500);
+    harness_clear_log();
+
+    harness_tap(KC_DOT);
+    harness_run(500);
+    EXPECT_LOG(CUT_WORD "+1b -1b ");
+}
+
+static void test_unknown_object(void) {
+    command_mode();
+    harness_tap(KC_C);
+    harness_tap(KC_W);
+    harness_tap(KC_X);
+    harness_tap(QK_VIM);
+    // `di"` doesn't do anything, so there's nothing for `.` to repeat
+    harness_tap(KC_D);
+    harness_tap(KC_I);
+    harness_tap(KC_QUOTE);
+    harness_run(500);
+    harness_clear_log();
+
+    harness_tap(KC_DOT);
+    harness_run(500);
+    EXPECT_LOG(CUT_WORD "+1b -1b ");
+}
+
+int main(void) {
+    test_change_word();
+    test_change_inner_word();
+    test_delete_around_paragraph();
+    test_yank_keeps_last_change();
+    test_unknown_object();
+    return harness_done();
+}
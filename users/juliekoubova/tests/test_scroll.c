@@ -0,0 +1,73 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Ctrl+E/Y/D/U, which scroll the view with the mouse wheel.
+
+#include "harness.h"
+#include "vim.h"
+
+static void command_mode(void) {
+    harness_reset();
+    harness_tap(QK_VIM);
+    harness_run(100);
+    harness_clear_log();
+}
+
+static void ctrl_tap(uint16_t keycode) {
+    harness_key(KC_LEFT_CTRL, true);
+    harness_tap(keycode);
+    harness_key(KC_LEFT_CTRL, false);
+    harness_run(100);
+}
+
+static void test_count(void) {
+    command_mode();
+    harness_tap(KC_5);
+    harness_tap(KC_0);
+    ctrl_tap(KC_E);
+    // a single report, no taps
+    EXPECT_LOG("W-50 ");
+    EXPECT(vim_get_mode() == VIM_MODE_COMMAND);
+}
+
+static void test_half_page(void) {
+    command_mode();
+    ctrl_tap(KC_D);
+    EXPECT_LOG("W-5 ");
+    ctrl_tap(KC_U);
+    EXPECT_LOG("W5 ");
+    ctrl_tap(KC_Y);
+    EXPECT_LOG("W1 ");
+}
+
+static void test_operator_dropped(void) {
+    command_mode();
+    harness_tap(KC_D);
+    // scrolls, and doesn't delete anything
+    ctrl_tap(KC_E);
+    EXPECT_LOG("W-1 ");
+    // nor is the `d` left pending for the next motion
+    harness_tap(KC_J);
+    harness_run(100);
+    EXPECT_LOG("+51 -51 ");
+}
+
+int main(void) {
+    test_count();
+    test_half_page();
+    test_operator_dropped();
+    return harness_done();
+}
@@ -0,0 +1,196 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The timer wheel, and the send queue it drives, on the virtual clock.
+
+#include "harness.h"
+#include "timer_wheel.h"
+#include "vim_send.h"
+
+static uint16_t emitted;
+static uint16_t repeated;
+
+static void count_emit(void) {
+    emitted++;
+}
+
+static void count_autorepeat(void) {
+    repeated++;
+}
+
+static void cancel_autorepeat(void) {
+    emitted++;
+    vim_timer_cancel(VIM_TIMER_AUTOREPEAT);
+}
+
+static void reschedule_emit(void) {
+    emitted++;
+    vim_timer_schedule(VIM_TIMER_EMIT, 10, reschedule_emit);
+}
+
+static void reset(void) {
+    harness_reset();
+    emitted  = 0;
+    repeated = 0;
+}
+
+// Ticks the wheel every millisecond, the way vim_task does.
+static void tick(uint32_t ms) {
+    while (ms--) {
+        harness_advance(1);
+        vim_timer_tick(timer_read());
+    }
+}
+
+static void test_fires_on_time(void) {
+    reset();
+    // short delays, the ones spanning several turns of the wheel, and the
+    // ones not falling on a bucket boundary
+    for (uint16_t delay = 1; delay < 300; delay += 7) {
+        vim_timer_schedule(VIM_TIMER_EMIT, delay, count_emit);
+        tick(delay - 1);
+        EXPECT(emitted == 0);
+        EXPECT(vim_timer_is_scheduled(VIM_TIMER_EMIT));
+        tick(1);
+        EXPECT(emitted == 1);
+        EXPECT(!vim_timer_is_scheduled(VIM_TIMER_EMIT));
+        emitted = 0;
+    }
+}
+
+static void test_long_delay(void) {
+    reset();
+    // the pending timeout goes around the wheel many times before it's due
+    vim_timer_schedule(VIM_TIMER_EMIT, 2000, count_emit);
+    tick(1999);
+    EXPECT(emitted == 0);
+    tick(1);
+    EXPECT(emitted == 1);
+}
+
+static void test_cancel(void) {
+    reset();
+    vim_timer_schedule(VIM_TIMER_EMIT, 20, count_emit);
+    vim_timer_schedule(VIM_TIMER_AUTOREPEAT, 20, count_autorepeat);
+    tick(10);
+    vim_timer_cancel(VIM_TIMER_EMIT);
+    EXPECT(!vim_timer_is_scheduled(VIM_TIMER_EMIT));
+    tick(100);
+    EXPECT(emitted == 0);
+    EXPECT(repeated == 1);
+}
+
+static void test_reschedule(void) {
+    reset();
+    vim_timer_schedule(VIM_TIMER_EMIT, 20, count_emit);
+    tick(10);
+    vim_timer_schedule(VIM_TIMER_EMIT, 20, count_emit);
+    tick(19);
+    EXPECT(emitted == 0);
+    tick(1);
+    EXPECT(emitted == 1);
+    tick(100);
+    EXPECT(emitted == 1);
+}
+
+static void test_callback_reschedules(void) {
+    reset();
+    vim_timer_schedule(VIM_TIMER_EMIT, 10, reschedule_emit);
+    tick(100);
+    EXPECT(emitted == 10);
+    vim_timer_cancel(VIM_TIMER_EMIT);
+}
+
+static void test_callback_cancels_due(void) {
+    reset();
+    // both are due on the same tick, the first one cancels the second one
+    vim_timer_schedule(VIM_TIMER_EMIT, 8, cancel_autorepeat);
+    vim_timer_schedule(VIM_TIMER_AUTOREPEAT, 8, count_autorepeat);
+    tick(8);
+    EXPECT(emitted == 1);
+    EXPECT(repeated == 0);
+    EXPECT(!vim_timer_is_scheduled(VIM_TIMER_AUTOREPEAT));
+}
+
+static void test_late_tick(void) {
+    reset();
+    // the scan loop was stalled for much longer than a turn of the wheel
+    vim_timer_schedule(VIM_TIMER_EMIT, 30, count_emit);
+    vim_timer_schedule(VIM_TIMER_AUTOREPEAT, 2000, count_autorepeat);
+    harness_advance(1000);
+    vim_timer_tick(timer_read());
+    EXPECT(emitted == 1);
+    EXPECT(repeated == 0);
+    tick(1000);
+    EXPECT(repeated == 1);
+}
+
+static void test_clock_wraps(void) {
+    reset();
+    harness_advance(UINT16_MAX - timer_read() - 10);
+    vim_timer_tick(timer_read());
+    vim_timer_schedule(VIM_TIMER_EMIT, 30, count_emit);
+    tick(29);
+    EXPECT(emitted == 0);
+    tick(1);
+    EXPECT(emitted == 1);
+    EXPECT(timer_read() < 30);
+}
+
+static void test_send_releases_taps(void) {
+    reset();
+    vim_send(KC_A, VIM_SEND_TAP);
+    vim_send(KC_B, VIM_SEND_TAP);
+    EXPECT_LOG("+04 ");
+    harness_run(VIM_TAP_DELAY - 1);
+    EXPECT_LOG("");
+    harness_run(1);
+    EXPECT_LOG("-04 +05 ");
+    harness_run(VIM_TAP_DELAY);
+    EXPECT_LOG("-05 ");
+    EXPECT(!vim_send_busy());
+}
+
+static void test_send_queue_full(void) {
+    reset();
+    // making room drains the whole queue here, as the clears don't send
+    // anything, and the key sent next mustn't wait for an emit that never
+    // comes
+    vim_send(KC_A, VIM_SEND_TAP);
+    for (uint8_t i = 0; i < 32; i++) {
+        vim_send_clear(0);
+    }
+    vim_send(KC_B, VIM_SEND_TAP);
+    EXPECT_LOG("+04 -04 +05 ");
+    harness_run(VIM_TAP_DELAY);
+    EXPECT_LOG("-05 ");
+    EXPECT(!vim_send_busy());
+    EXPECT(!harness_is_key_down(KC_B));
+}
+
+int main(void) {
+    test_fires_on_time();
+    test_long_delay();
+    test_cancel();
+    test_reschedule();
+    test_callback_reschedules();
+    test_callback_cancels_due();
+    test_late_tick();
+    test_clock_wraps();
+    test_send_releases_taps();
+    test_send_queue_full();
+    return harness_done();
+}
@@ -0,0 +1,97 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// V-block mode without a column selection on the host, one line at a time.
+
+#include <string.h>
+#include "harness.h"
+#include "vim.h"
+
+static void command_mode(void) {
+    harness_reset();
+    harness_tap(QK_VIM);
+    harness_run(100);
+    harness_clear_log();
+}
+
+static void ctrl_v(void) {
+    harness_key(KC_LCTL, true);
+    harness_tap(KC_V);
+    harness_key(KC_LCTL, false);
+}
+
+static uint16_t count(const char *needle) {
+    uint16_t found = 0;
+    for (const char *at = harness_log; (at = strstr(at, needle)); at++) {
+        found++;
+    }
+    return found;
+}
+
+static void test_from_visual(void) {
+    command_mode();
+    harness_tap(KC_V);
+    harness_tap(KC_L);
+    harness_run(100);
+    harness_clear_log();
+
+    // the selection is dropped at the cursor, on the right
+    ctrl_v();
+    harness_run(100);
+    EXPECT(vim_get_mode() == VIM_MODE_VBLOCK);
+    EXPECT_LOG("+4f -4f ");
+    harness_tap(KC_ESCAPE);
+}
+
+static void test_from_vline(void) {
+    command_mode();
+    harness_key(KC_LSFT, true);
+    harness_tap(KC_V);
+    harness_key(KC_LSFT, false);
+    ctrl_v();
+    EXPECT(vim_get_mode() == VIM_MODE_VBLOCK);
+    harness_tap(KC_ESCAPE);
+}
+
+static void test_wide_delete(void) {
+    command_mode();
+    ctrl_v();
+    // 200 characters wide, more than vim_send_repeated counts at once, with
+    // VIM_SELECTION_MAX_REPLAY raised. `20l` at a time fits in the queue, so
+    // that the release of `l` isn't taken for a held one.
+    for (uint8_t i = 0; i < 10; i++) {
+        harness_tap(KC_2);
+        harness_tap(KC_0);
+        harness_tap(KC_L);
+        harness_run(500);
+    }
+    harness_tap(KC_J);
+    harness_run(500);
+    harness_clear_log();
+
+    harness_tap(KC_D);
+    harness_run(5000);
+    EXPECT(vim_get_mode() == VIM_MODE_COMMAND);
+    EXPECT(count("+4c ") == 400);
+    EXPECT(count("+50 ") == 200);
+}
+
+int main(void) {
+    test_from_visual();
+    test_from_vline();
+    test_wide_delete();
+    return harness_done();
+}
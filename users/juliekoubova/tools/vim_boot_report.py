@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+# Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""Reports how soon after a boot the shortcuts for the right host are sent.
+
+Reads console logs of a keyboard built with VIM_DEBUG and VIM_HOST_EEPROM,
+raw or already decoded by vim_log_decode.py. Every `host=... from EEPROM` line
+starts a boot, the first `host=...` line after it is OS detection. The host is
+right from the EEPROM line on if the two agree, otherwise only from OS
+detection on. Without VIM_HOST_EEPROM, it'd be Windows until OS detection.
+
+    qmk console > boots.log
+    users/juliekoubova/tools/vim_boot_report.py boots.log
+"""
+
+import argparse
+import io
+import pathlib
+import re
+import statistics
+
+import vim_log_decode
+
+VIM = pathlib.Path(__file__).resolve().parent.parent / "vim"
+EEPROM = re.compile(r"host=(\d+) from EEPROM at (\d+) ms")
+DETECTED = re.compile(r"host=(\d+), was -?\d+, at (\d+) ms")
+DEFAULT_HOST = 0
+
+
+def enum_names(header, prefix, sentinel):
+    names = []
+    for name in re.findall(r"\b(" + prefix + r"\w+)\s*(?:=\s*\w+\s*)?,", header.read_text()):
+        if name == sentinel:
+            break
+        names.append(name[len(prefix) :].lower())
+    return names
+
+
+def read_lines(path):
+    text = path.read_text(errors="replace")
+    if re.search(r"^vim:[0-9a-f]+", text, re.MULTILINE):
+        out = io.StringIO()
+        messages = vim_log_decode.load_messages(VIM / "debug.h")
+        vim_log_decode.decode(io.StringIO(text), messages, out)
+        text = out.getvalue()
+    return text.splitlines()
+
+
+def parse(lines):
+    boots = []
+    for line in lines:
+        match = EEPROM.search(line)
+        if match:
+            boots.append({"saved": int(match[1]), "boot": int(match[2])})
+            continue
+        match = DETECTED.search(line)
+        if match and boots and "detected" not in boots[-1]:
+            boots[-1]["detected"] = int(match[1])
+            boots[-1]["at"] = int(match[2])
+    return boots
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("logs", nargs="+", type=pathlib.Path)
+    args = parser.parse_args()
+
+    hosts = enum_names(VIM / "host.h", "VIM_HOST_", "VIM_HOST_COUNT")
+    with_eeprom, without_eeprom = [], []
+    for path in args.logs:
+        for boot in parse(read_lines(path)):
+            saved = hosts[boot["saved"]]
+            if "detected" not in boot:
+                print(f"{path}: {saved} from EEPROM at {boot['boot']} ms, not detected")
+                continue
+            right = boot["boot"] if boot["saved"] == boot["detected"] else boot["at"]
+            before = boot["boot"] if boot["detected"] == DEFAULT_HOST else boot["at"]
+            with_eeprom.append(right)
+            without_eeprom.append(before)
+            print(
+                f"{path}: {saved} from EEPROM at {boot['boot']} ms, "
+                f"{hosts[boot['detected']]} detected at {boot['at']} ms, "
+                f"right from {right} ms"
+            )
+
+    if with_eeprom:
+        print(
+            f"{len(with_eeprom)} boots, right host from "
+            f"{statistics.median(with_eeprom)} ms median, {max(with_eeprom)} ms worst, "
+            f"without VIM_HOST_EEPROM {statistics.median(without_eeprom)} ms median, "
+            f"{max(without_eeprom)} ms worst"
+        )
+
+
+if __name__ == "__main__":
+    main()
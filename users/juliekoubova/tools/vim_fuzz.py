@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+# Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""Seeds, shrinks and prints inputs of the Vim mode fuzz target.
+
+The key table comes from tests/fuzz_vim.c and the bindings from
+vim/statemachine.c, so this is always in sync with the target it was built
+with.
+
+    vim_fuzz.py corpus DIR                 one seed for every binding
+    vim_fuzz.py minimize CRASH -o SMALLER  the fewest events that still fail
+    vim_fuzz.py print INPUT                the events, as keys
+
+The minimizer drops events, a chunk at a time and then one by one, and then
+their extra mods and waits, for as long as the standalone target keeps failing
+with the same message. With libFuzzer, `-minimize_crash=1` shrinks bytes too,
+and its output can be printed here.
+"""
+
+import argparse
+import pathlib
+import re
+import subprocess
+import sys
+import tempfile
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+TESTS = ROOT / "tests"
+KEYS = re.compile(r"fuzz_keys\[\]\s*=\s*\{(.*?)\};", re.S)
+TABLE = re.compile(r"vim_statemachine_t (vsm_\w+)\[VSM_SIZE\][^{]*\{(.*?)\};", re.S)
+BINDING = re.compile(r"\b(VSM\w*)\((KC_\w+)")
+HOSTS = ["windows", "mac", "linux"]
+
+# How each table is reached from insert mode: the keys tapped first, each with
+# the mod held around it, and the mod held around the bound key itself.
+TABLES = {
+    "vsm_command": ([], None),
+    "vsm_command_shift": ([], "KC_LSFT"),
+    "vsm_command_ctrl": ([], "KC_LCTL"),
+    "vsm_operator": ([("KC_D", None)], None),
+    "vsm_visual": ([("KC_V", None)], None),
+    "vsm_visual_shift": ([("KC_V", None)], "KC_LSFT"),
+    "vsm_visual_ctrl": ([("KC_V", None)], "KC_LCTL"),
+    "vsm_vline": ([("KC_V", "KC_LSFT")], None),
+    "vsm_vline_shift": ([("KC_V", "KC_LSFT")], "KC_LSFT"),
+    "vsm_vline_ctrl": ([("KC_V", "KC_LSFT")], "KC_LCTL"),
+    "vsm_vblock": ([("KC_V", "KC_LCTL")], None),
+    "vsm_vblock_ctrl": ([("KC_V", "KC_LCTL")], "KC_LCTL"),
+}
+
+
+def load_keys(source):
+    table = KEYS.search(source.read_text()).group(1)
+    return [key.strip() for key in re.split(r",\s*(?![^()]*\))", table) if key.strip()]
+
+
+def load_bindings(source):
+    for table, body in TABLE.findall(source.read_text()):
+        for kind, key in BINDING.findall(body):
+            yield table, kind, key
+
+
+def seed(host, taps, keys):
+    data = bytearray([host])
+    for key, mod in taps:
+        if mod:
+            data += bytes([keys.index(mod), 0, 1])
+        data += bytes([keys.index(key), 0, 1, keys.index(key), 0, 1])
+        if mod:
+            data += bytes([keys.index(mod), 0, 1])
+    return bytes(data)
+
+
+def corpus(args):
+    keys = load_keys(args.source)
+    args.output.mkdir(parents=True, exist_ok=True)
+    count = 0
+    for table, kind, key in load_bindings(args.bindings):
+        if table not in TABLES:
+            print(f"{table}: don't know how to get there, skipped", file=sys.stderr)
+            continue
+        prefix, mod = TABLES[table]
+        taps = [("QK_VIM", None)] + prefix + [(key, mod)]
+        # a motion, or the argument of `q` and `@`, and then a count
+        taps += [("KC_W", None), ("KC_3", None), ("KC_J", None)]
+        if kind == "VSM_HOLD":
+            taps += [(key, mod)]
+        path = args.output / f"{table[4:]}_{key[3:].lower()}"
+        path.write_bytes(seed(count % len(HOSTS), taps, keys))
+        count += 1
+    print(f"{count} seeds in {args.output}", file=sys.stderr)
+
+
+def failure(target, data):
+    with tempfile.NamedTemporaryFile(suffix=".fuzz") as file:
+        file.write(data)
+        file.flush()
+        result = subprocess.run([str(target), file.name], capture_output=True, text=True)
+    if result.returncode == 0:
+        return None
+    lines = (result.stdout + result.stderr).splitlines()
+    return lines[0] if lines else str(result.returncode)
+
+
+def minimize(args):
+    data = args.input.read_bytes()
+    expected = failure(args.target, data)
+    if expected is None:
+        sys.exit("the input doesn't fail")
+    print(f"fails with: {expected}", file=sys.stderr)
+
+    head, events = data[:1], [data[i : i + 3] for i in range(1, len(data) - 2, 3)]
+    chunk = len(events) // 2
+    while chunk:
+        start = 0
+        while start < len(events):
+            candidate = events[:start] + events[start + chunk :]
+            if failure(args.target, head + b"".join(candidate)) == expected:
+                events = candidate
+            else:
+                start += chunk
+        print(f"{len(events)} events left", file=sys.stderr)
+        chunk //= 2
+
+    # then without the extra mods and the waits, where they don't matter
+    for simpler in (lambda e: bytes([e[0], 0, e[2]]), lambda e: bytes([e[0], e[1], 0])):
+        for i, event in enumerate(events):
+            candidate = events[:i] + [simpler(event)] + events[i + 1 :]
+            if candidate != events and failure(args.target, head + b"".join(candidate)) == expected:
+                events = candidate
+
+    data = head + b"".join(events)
+    if args.output:
+        args.output.write_bytes(data)
+    describe(data, load_keys(args.source))
+
+
+def describe(data, keys):
+    print(f"host {HOSTS[data[0] % len(HOSTS)]}")
+    held = [False] * len(keys)
+    for i in range(1, len(data) - 2, 3):
+        key, mods, time = data[i : i + 3]
+        index = key % len(keys)
+        held[index] = not held[index]
+        line = f"{'press  ' if held[index] else 'release'} {keys[index]}"
+        if mods & 0x80:
+            line += f" one-shot mods {mods & 0x0F:x}"
+        if time < 0x80:
+            line += f", {time & 7} ms"
+        else:
+            line += f", stall {(time & 0x7F) * 40} ms"
+        print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--source", type=pathlib.Path, default=TESTS / "fuzz_vim.c")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    command = commands.add_parser("corpus", help="one seed for every binding")
+    command.add_argument("output", type=pathlib.Path)
+    command.add_argument("--bindings", type=pathlib.Path, default=ROOT / "vim" / "statemachine.c")
+    command.set_defaults(run=corpus)
+
+    command = commands.add_parser("minimize", help="shrink an input that fails")
+    command.add_argument("input", type=pathlib.Path)
+    command.add_argument("-o", "--output", type=pathlib.Path)
+    command.add_argument("--target", type=pathlib.Path, default=TESTS / "build" / "fuzz_vim")
+    command.set_defaults(run=minimize)
+
+    command = commands.add_parser("print", help="print an input as keys")
+    command.add_argument("input", type=pathlib.Path)
+    command.set_defaults(run=lambda args: describe(args.input.read_bytes(), load_keys(args.source)))
+
+    args = parser.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    main()
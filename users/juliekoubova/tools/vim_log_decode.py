@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+# Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""Decodes the tokenized Vim mode log.
+
+With VIM_DEBUG, the firmware prints its log as hex on lines starting with
+`vim:`. The message table comes straight from vim/debug.h, so the decoder is
+always in sync with the firmware it was built with.
+
+    qmk console | users/juliekoubova/tools/vim_log_decode.py
+"""
+
+import argparse
+import pathlib
+import re
+import sys
+
+LEVELS = ["ERROR", "INFO", "DEBUG", "TRACE"]
+MESSAGE = re.compile(r'X\((\w+),\s*(\w+),\s*"((?:[^"\\]|\\.)*)"\)')
+LINE = re.compile(r"vim:([0-9a-f]+)")
+SPECIFIER = re.compile(r"%([dxuc%])")
+
+
+def load_messages(header):
+    return [(name, fmt) for name, _, fmt in MESSAGE.findall(header.read_text())]
+
+
+def format_message(fmt, args):
+    args = iter(args)
+
+    def replace(match):
+        spec = match.group(1)
+        if spec == "%":
+            return "%"
+        value = next(args, 0)
+        if spec == "d":
+            return str(value - 0x10000 if value & 0x8000 else value)
+        if spec == "x":
+            return f"{value:x}"
+        if spec == "c":
+            return chr(value) if 32 <= value < 127 else f"\\x{value:02x}"
+        return str(value)
+
+    return SPECIFIER.sub(replace, fmt)
+
+
+def decode(stream, messages, out):
+    data = bytearray()
+    for line in stream:
+        match = LINE.search(line)
+        if not match:
+            out.write(line)
+            continue
+        data += bytes.fromhex(match.group(1))
+        while len(data) >= 2:
+            token = data[0] | data[1] << 8
+            argc = (token >> 11) & 0x7
+            if len(data) < 2 + 2 * argc:
+                break
+            args = [data[2 + 2 * i] | data[3 + 2 * i] << 8 for i in range(argc)]
+            del data[: 2 + 2 * argc]
+
+            index = token & 0x7FF
+            level = LEVELS[token >> 14]
+            if index < len(messages):
+                text = format_message(messages[index][1], args)
+            else:
+                text = f"unknown message {index} {args}"
+            out.write(f"[vim] {level:5} {text}\n")
+        out.flush()
+
+
+def main():
+    default_header = pathlib.Path(__file__).resolve().parent.parent / "vim" / "debug.h"
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", type=argparse.FileType("r"), default=sys.stdin)
+    parser.add_argument("--header", type=pathlib.Path, default=default_header)
+    args = parser.parse_args()
+    decode(args.log, load_messages(args.header), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""Decodes the VIM_RECORDER flight recorder.
+
+Dumps are either console logs containing the `vimrec:` lines printed by the
+magic key combination followed by R, or raw binary dumps read over raw HID.
+
+    users/juliekoubova/tools/vim_recorder_decode.py corne.log
+
+With --inputs, only the keys are printed, as a C initializer of
+`{delay_ms, keycode, pressed, tapped}` for a harness to feed back into
+process_record_vim. With --sends, only what Vim mode sent is printed, without
+the times, so that a replay can be diffed against the original.
+"""
+
+import argparse
+import pathlib
+import re
+import struct
+
+VIM = pathlib.Path(__file__).resolve().parent.parent / "vim"
+MAGIC = 0x5256
+HEADER = "<HHBBH"
+MODS = ["lctl", "lsft", "lalt", "lgui", "rctl", "rsft", "ralt", "rgui"]
+
+
+def enum_names(header, prefix, sentinel):
+    names = []
+    for name in re.findall(r"\b(" + prefix + r"\w+)\s*(?:=\s*\w+\s*)?,", header.read_text()):
+        if name == sentinel:
+            break
+        names.append(name[len(prefix) :].lower())
+    return names
+
+
+def read_dumps(path):
+    data = path.read_bytes()
+    if data[:2] == struct.pack("<H", MAGIC):
+        yield data
+        return
+    dump = bytearray()
+    for line in data.decode(errors="replace").splitlines():
+        match = re.search(r"vimrec:(\w+)", line)
+        if not match:
+            continue
+        if match.group(1) == "end":
+            yield bytes(dump)
+            dump = bytearray()
+        else:
+            dump += bytes.fromhex(match.group(1))
+
+
+def parse(dump):
+    magic, count, host, mode, dropped = struct.unpack_from(HEADER, dump)
+    if magic != MAGIC:
+        raise ValueError("not a vim recorder dump")
+    offset = struct.calcsize(HEADER)
+    events = []
+    time = 0
+    for header, value in struct.iter_unpack("<HH", dump[offset : offset + 4 * count]):
+        time += header & 0xFFF
+        events.append((time, header >> 12, value))
+    return host, mode, dropped, events
+
+
+def mods_name(mods):
+    return "+".join(MODS[bit] for bit in range(8) if mods & (1 << bit))
+
+
+def keycode_name(code16):
+    # QK_MODS keycodes keep the five-bit mods in the high byte
+    mods = (code16 >> 8) & 0x1F
+    if code16 < 0x2000 and mods:
+        bits = (mods & 0xF) << 4 if mods & 0x10 else mods
+        return f"{mods_name(bits)}+0x{code16 & 0xFF:02x}"
+    return f"0x{code16:04x}"
+
+
+def lookup(names, index):
+    return names[index] if index < len(names) else str(index)
+
+
+def describe(kind, value, names):
+    name = lookup(names["types"], kind)
+    if name == "mode":
+        return f"{name} {lookup(names['modes'], value)}"
+    if name == "host":
+        return f"{name} {lookup(names['hosts'], value)}"
+    if name == "send_up":
+        return f"{name} {mods_name(value >> 8) or '-'} 0x{value & 0xFF:02x}"
+    if name == "send_clear":
+        return f"{name} {mods_name(value) or '-'}"
+    if name == "send_wheel":
+        return f"{name} {value - 0x10000 if value & 0x8000 else value}"
+    return f"{name} {keycode_name(value)}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dumps", nargs="+", type=pathlib.Path)
+    output = parser.add_mutually_exclusive_group()
+    output.add_argument("--inputs", action="store_true", help="print the keys as a C initializer")
+    output.add_argument("--sends", action="store_true", help="print only what was sent")
+    args = parser.parse_args()
+
+    types = enum_names(VIM / "recorder.h", "VIM_RECORD_", "VIM_RECORD_COUNT")
+    names = {
+        "types": types,
+        "modes": ["-"] + enum_names(VIM / "vim_mode.h", "VIM_MODE_", "VIM_MODE_COUNT"),
+        "hosts": enum_names(VIM / "host.h", "VIM_HOST_", "VIM_HOST_COUNT"),
+    }
+
+    for path in args.dumps:
+        for dump in read_dumps(path):
+            host, mode, dropped, events = parse(dump)
+            if not args.sends:
+                prefix = "// " if args.inputs else ""
+                print(
+                    f"{prefix}{path}: {len(events)} events, {dropped} overwritten, "
+                    f"host={lookup(names['hosts'], host)} mode={lookup(names['modes'], mode)} at the dump"
+                )
+            previous = events[0][0] if events else 0
+            for time, kind, value in events:
+                if args.inputs:
+                    if kind <= types.index("tap_down"):
+                        print(f"{{{time - previous:5}, 0x{value:04x}, {kind & 1}, {kind >> 1}}},")
+                        previous = time
+                    elif kind in (types.index("mode"), types.index("host")):
+                        print(f"// {describe(kind, value, names)}")
+                elif args.sends:
+                    if kind >= types.index("send_down"):
+                        print(describe(kind, value, names))
+                else:
+                    print(f"{time:8} ms  {describe(kind, value, names)}")
+
+
+if __name__ == "__main__":
+    main()
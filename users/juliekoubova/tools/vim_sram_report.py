@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+# Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""Shows how much SRAM Vim mode uses in a firmware built with VIM_SRAM.
+
+    users/juliekoubova/tools/vim_sram_report.py .build/crkbd_rev1_juliekoubova.elf
+"""
+
+import argparse
+import subprocess
+
+SRAM_START = 0x20000000
+SRAM_END = 0x20042000
+KINDS = {"t": "code", "d": "data", "b": "bss"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    args = parser.parse_args()
+
+    output = subprocess.run(
+        [args.nm, "--size-sort", "--print-size", args.elf], check=True, capture_output=True, text=True
+    ).stdout
+
+    totals = {kind: 0 for kind in KINDS.values()}
+    for line in reversed(output.splitlines()):
+        fields = line.split()
+        if len(fields) != 4:
+            continue
+        address, size, kind, name = int(fields[0], 16), int(fields[1], 16), fields[2].lower(), fields[3]
+        if not name.startswith(("vim_", "vsm_")) or kind not in KINDS:
+            continue
+        if not SRAM_START <= address < SRAM_END:
+            continue
+        totals[KINDS[kind]] += size
+        print(f"{size:6} {KINDS[kind]:4} {name}")
+    print(", ".join(f"{kind} {size} bytes" for kind, size in totals.items()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+# Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""Merges VIM_STATS dumps from any number of keyboards into a single report.
+
+Dumps are either console logs containing the `vimstats:` lines printed by the
+magic key combination followed by S, or raw binary dumps read over raw HID.
+
+    users/juliekoubova/tools/vim_stats_report.py julie.log q4.bin corne.log
+"""
+
+import argparse
+import collections
+import pathlib
+import re
+import struct
+
+VIM = pathlib.Path(__file__).resolve().parent.parent / "vim"
+MAGIC = 0x5356
+OPERATORS = ["c", "d", "y"]
+
+
+def enum_names(header, prefix, sentinel):
+    names = []
+    for name in re.findall(r"\b(" + prefix + r"\w+)\s*(?:=\s*\w+\s*)?,", header.read_text()):
+        if name == sentinel:
+            break
+        names.append(name[len(prefix) :].lower())
+    return names
+
+
+def read_dumps(path):
+    data = path.read_bytes()
+    if data[:2] == struct.pack("<H", MAGIC):
+        yield data
+        return
+    dump = bytearray()
+    for line in data.decode(errors="replace").splitlines():
+        match = re.search(r"vimstats:(\w+)", line)
+        if not match:
+            continue
+        if match.group(1) == "end":
+            yield bytes(dump)
+            dump = bytearray()
+        else:
+            dump += bytes.fromhex(match.group(1))
+
+
+def parse(dump):
+    magic, modes, actions = struct.unpack_from("<HBB", dump)
+    if magic != MAGIC:
+        raise ValueError("not a vim stats dump")
+    count = modes * actions + modes + len(OPERATORS) + 2
+    values = struct.unpack_from(f"<{count}H", dump, 4)
+    counters = [values[m * actions : (m + 1) * actions] for m in range(modes)]
+    rest = values[modes * actions :]
+    return {
+        "counters": counters,
+        "mode_switches": rest[:modes],
+        "operators": rest[modes : modes + len(OPERATORS)],
+        "counted": rest[-2],
+        "abandoned": rest[-1],
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dumps", nargs="+", type=pathlib.Path)
+    args = parser.parse_args()
+
+    actions = ["none"] + enum_names(VIM / "statemachine.h", "VIM_ACTION_", "VIM_ACTION_COUNT")[1:]
+    modes = ["-"] + enum_names(VIM / "vim_mode.h", "VIM_MODE_", "VIM_MODE_COUNT")
+
+    def name(names, index):
+        return names[index] if index < len(names) else str(index)
+
+    commands = collections.Counter()
+    switches = collections.Counter()
+    operators = collections.Counter()
+    counted = abandoned = keyboards = 0
+
+    for path in args.dumps:
+        for dump in read_dumps(path):
+            stats = parse(dump)
+            keyboards += 1
+            for mode, row in enumerate(stats["counters"]):
+                for action, value in enumerate(row):
+                    if value:
+                        commands[(name(modes, mode), name(actions, action))] += value
+            for mode, value in enumerate(stats["mode_switches"]):
+                switches[name(modes, mode)] += value
+            for operator, value in zip(OPERATORS, stats["operators"]):
+                operators[operator] += value
+            counted += stats["counted"]
+            abandoned += stats["abandoned"]
+
+    total = sum(commands.values()) or 1
+    print(f"{keyboards} dumps, {sum(commands.values())} commands")
+    print(f"with a count: {counted} ({100 * counted / total:.1f}%)")
+    print(f"abandoned operators and counts: {abandoned}")
+    print("operators: " + ", ".join(f"{o}={operators[o]}" for o in OPERATORS))
+    print("mode switches: " + ", ".join(f"{m}={v}" for m, v in switches.most_common() if v))
+    print()
+    print(f"{'mode':10} {'action':18} {'count':>8} {'share':>7}")
+    for (mode, action), value in commands.most_common():
+        print(f"{mode:10} {action:18} {value:8} {100 * value / total:6.1f}%")
+
+
+if __name__ == "__main__":
+    main()
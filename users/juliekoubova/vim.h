@@ -18,9 +18,31 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "quantum/quantum.h"
+#include "vim/debug.h"
+#include "vim/ex.h"
+#include "vim/fast_path.h"
+#include "vim/host.h"
+#include "vim/profile.h"
+#include "vim/recorder.h"
 #include "vim/vim_mode.h"
 
-bool process_record_vim(uint16_t keycode, const keyrecord_t *record, uint16_t vim_keycode);
+bool vim_process_record(uint16_t keycode, const keyrecord_t *record, uint16_t vim_keycode);
+
+// Call this from process_record_user, or from pre_process_record_user to have
+// the keys handled by the engine skip the rest of QMK's processing. Typing in
+// insert mode only costs a load and two compares here, and a look at the mods
+// for the key of the one-shot chord.
+static inline bool process_record_vim(uint16_t keycode, const keyrecord_t *record,
+                                      uint16_t vim_keycode) {
+    vim_record_key(keycode, record);
+    if (!vim_slow_path && keycode != vim_keycode && !vim_may_be_oneshot_chord(keycode)) {
+        return true;
+    }
+    return vim_process_record(keycode, record, vim_keycode);
+}
 bool vim_is_active_key(uint16_t keycode);
 void vim_set_apple(bool apple);
+void vim_init(void);
+void vim_shutdown(void);
 void vim_task(void);
+bool vim_command_extra(uint8_t code);
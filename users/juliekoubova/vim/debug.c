@@ -0,0 +1,96 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "debug.h"
+#include "quantum/quantum.h"
+
+#ifndef VIM_LOG_LEVEL
+#    define VIM_LOG_LEVEL VIM_LOG_INFO
+#endif
+
+#ifdef VIM_DEBUG
+
+// Logged messages wait here until vim_task prints them, a few at a time.
+#    ifndef VIM_LOG_BUFFER_SIZE
+#        define VIM_LOG_BUFFER_SIZE 256
+#    endif
+
+#    ifndef VIM_LOG_FLUSH_BYTES
+#        define VIM_LOG_FLUSH_BYTES 16
+#    endif
+
+_Static_assert((VIM_LOG_BUFFER_SIZE & (VIM_LOG_BUFFER_SIZE - 1)) == 0,
+               "VIM_LOG_BUFFER_SIZE must be a power of two");
+_Static_assert(VIM_LOG_MESSAGE_COUNT <= 0x800, "message ids have 11 bits");
+
+uint8_t vim_log_level = VIM_LOG_LEVEL;
+
+static uint8_t  vim_log_buffer[VIM_LOG_BUFFER_SIZE];
+static uint16_t vim_log_head    = 0;
+static uint16_t vim_log_tail    = 0;
+static uint16_t vim_log_dropped = 0;
+
+static void vim_log_put(uint16_t word) {
+    vim_log_buffer[vim_log_head++ % VIM_LOG_BUFFER_SIZE] = word & 0xff;
+    vim_log_buffer[vim_log_head++ % VIM_LOG_BUFFER_SIZE] = word >> 8;
+}
+
+void vim_log_write(uint16_t id, const uint16_t *args) {
+    uint8_t argc = (id >> 11) & 0x7;
+    if ((uint16_t)(vim_log_head - vim_log_tail) + 2 + 2 * argc > VIM_LOG_BUFFER_SIZE) {
+        if (vim_log_dropped < UINT16_MAX) {
+            vim_log_dropped++;
+        }
+        return;
+    }
+    vim_log_put(id);
+    for (uint8_t i = 0; i < argc; i++) {
+        vim_log_put(args[i]);
+    }
+}
+
+// Prints the logged bytes as hex, e.g. `vim:4000a1c5...`.
+void vim_log_flush(void) {
+    if (vim_log_dropped && vim_log_head == vim_log_tail) {
+        uint16_t dropped = vim_log_dropped;
+        vim_log_dropped  = 0;
+        VIM_LOG(LOG_DROPPED, dropped);
+    }
+    if (vim_log_head == vim_log_tail) {
+        return;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    char              line[2 * VIM_LOG_FLUSH_BYTES + 1];
+    uint8_t           length = 0;
+    while (vim_log_tail != vim_log_head && length < 2 * VIM_LOG_FLUSH_BYTES) {
+        uint8_t byte   = vim_log_buffer[vim_log_tail++ % VIM_LOG_BUFFER_SIZE];
+        line[length++] = hex[byte >> 4];
+        line[length++] = hex[byte & 0xf];
+    }
+    line[length] = 0;
+    xprintf("vim:%s\n", line);
+}
+
+void vim_set_log_level(vim_log_level_t level) {
+    vim_log_level = level;
+}
+
+#else
+
+void vim_set_log_level(vim_log_level_t level) {}
+
+#endif
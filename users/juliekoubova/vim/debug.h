@@ -15,13 +15,114 @@
  */
 
 #pragma once
+#include <stdint.h>
 #include "quantum/logging/print.h"
 
+typedef enum {
+    VIM_LOG_ERROR,
+    VIM_LOG_INFO,
+    VIM_LOG_DEBUG,
+    VIM_LOG_TRACE,
+} vim_log_level_t;
+
+// Log messages are tokenized: the firmware only logs the message id and its
+// 16-bit arguments, and tools/vim_log_decode.py turns them back into text
+// using this very table. Only ever append to it, so that old logs still decode.
+// clang-format off
+#define VIM_LOG_MESSAGES(X) \
+    X(LOG_DROPPED,          ERROR, "log: dropped %d messages") \
+    X(KEY,                  TRACE, "key=%x pressed=%d mode=%d mods=%x vim_key=%d") \
+    X(KEY_MACRO,            TRACE, "macro key=%x pressed=%d mode=%d") \
+    X(STATE,                TRACE, "state action=%x") \
+    X(STATE_NONE,           TRACE, "state=NULL") \
+    X(VIM_KEY_INSERT,       DEBUG, "vim key pressed in insert mode") \
+    X(VIM_KEY_COMMAND,      DEBUG, "vim key pressed in non-insert mode") \
+    X(VIM_KEY_RELEASED,     DEBUG, "vim key released, vim_key_state=%d") \
+    X(VIM_KEY_STATE,        TRACE, "vim_key_state=%d") \
+    X(MODE_SET,             INFO,  "entering mode=%d, capturing mods=%x") \
+    X(MODE_INSERT,          DEBUG, "entering INSERT mode, restoring mods=%x") \
+    X(MODE_COMMAND,         DEBUG, "entering COMMAND mode") \
+    X(MODE_VISUAL,          DEBUG, "entering VISUAL mode") \
+    X(MODE_VLINE,           DEBUG, "entering V-LINE mode") \
+    X(MODE_EX,              DEBUG, "entering EX mode") \
+    X(MODE_ENTER,           TRACE, "vim_enter_mode: %d") \
+    X(MODE_RESTORE,         INFO,  "restoring mode=%d") \
+    X(MODS,                 TRACE, "vim_mods=%x") \
+    X(PENDING,              DEBUG, "pending repeat=%d keycode=%x argument=%x") \
+    X(PENDING_CLEAR,        TRACE, "vim_clear_pending") \
+    X(PENDING_TIMEOUT,      INFO,  "pending timed out") \
+    X(ACTION,               DEBUG, "vim_perform_action %x") \
+    X(SEND_MODS,            TRACE, "register mods=%x") \
+    X(SEND_KEY,             TRACE, "register keycode=%x") \
+    X(SEND_KEY_UP,          TRACE, "unregister keycode=%x") \
+    X(SEND_MODS_UP,         TRACE, "unregister mods=%x") \
+    X(SEND_RESTORE_MODS,    DEBUG, "restoring mods=%x") \
+    X(SEND_QUEUE_FULL,      INFO,  "send queue full, waiting") \
+    X(HOST_EEPROM,          INFO,  "host=%d from EEPROM at %u ms") \
+    X(HOST,                 INFO,  "host=%d, was %d, at %u ms") \
+    X(SNAPSHOT_NONE,        INFO,  "snapshot: none found") \
+    X(SNAPSHOT_RESTORE,     INFO,  "snapshot: restoring host=%d mode=%d at %u ms") \
+    X(EX_BUFFER,            DEBUG, "ex: %d chars, last '%c'") \
+    X(EX_COMMAND,           INFO,  "ex: command=%d") \
+    X(MACRO_EEPROM_INVALID, INFO,  "macro: no valid macros in EEPROM") \
+    X(MACRO_RECORD,         INFO,  "macro: recording register %c") \
+    X(MACRO_STOP,           INFO,  "macro: stopped recording register %c") \
+    X(MACRO_FULL,           ERROR, "macro: arena full, recording stopped") \
+    X(MACRO_INTERRUPTED,    INFO,  "macro: playback interrupted") \
+    X(MACRO_BUSY,           INFO,  "macro: can't play register %c now") \
+    X(MACRO_PLAY,           INFO,  "macro: playing register %c %d times") \
+    X(MACRO_FINISHED,       INFO,  "macro: playback finished") \
+    X(MACRO_REGISTER_SIZE,  DEBUG, "macro: register %c uses %d bytes") \
+    X(MACRO_USAGE,          INFO,  "macro: %d of %d bytes used") \
+    X(REPEAT_RECORD,        DEBUG, "repeat: recording action=%x pending=%x repeat=%d") \
+    X(REPEAT_OVERFLOW,      ERROR, "repeat: insert buffer overflow") \
+    X(REPEAT_RECORDED,      DEBUG, "repeat: recorded %d keys, inserting %d more times") \
+    X(REPEAT_NOTHING,       INFO,  "repeat: nothing to repeat") \
+    X(REPEAT_REPLAY,        DEBUG, "repeat: replaying action=%x repeat=%d") \
+    X(PROFILE_STALL,        ERROR, "profile: probe %d stalled for %u us") \
+    X(SELECTION,            TRACE, "selection: lines=%d chars=%d exact=%d") \
+    X(SELECTION_LOST,       INFO,  "selection: lost track of the other end") \
+    X(INVARIANT,            ERROR, "invariant %d broken in mode=%d") \
+    X(SEND_WHEEL,           TRACE, "wheel %d") \
+    X(MODE_SEARCH,          DEBUG, "entering search mode") \
+    X(SEARCH,               INFO,  "search: opening find, backward=%d") \
+    X(SEARCH_WORD,          INFO,  "search: word under cursor, backward=%d repeat=%d") \
+    X(SEARCH_NEXT,          DEBUG, "search: next match, reverse=%d repeat=%d") \
+    X(MODE_ONESHOT,         DEBUG, "entering COMMAND mode for a single command") \
+    X(MODS_ONESHOT,         DEBUG, "one-shot mods=%x") \
+    X(PASSTHROUGH,          DEBUG, "passthrough keycode=%x mods=%x") \
+    X(MODE_VBLOCK,          DEBUG, "entering V-BLOCK mode") \
+    X(BLOCK,                DEBUG, "block lines=%d chars=%d strategy=%d") \
+    X(SEND_CLEAR,           DEBUG, "clearing keyboard, mods=%x")
+// clang-format on
+
+#define VIM_LOG_MESSAGE_ID(name, level, format) VIM_LOG_MESSAGE_##name,
+#define VIM_LOG_MESSAGE_LEVEL(name, level, format) VIM_LOG_LEVEL_##name = VIM_LOG_##level,
+
+typedef enum { VIM_LOG_MESSAGES(VIM_LOG_MESSAGE_ID) VIM_LOG_MESSAGE_COUNT } vim_log_message_t;
+enum { VIM_LOG_MESSAGES(VIM_LOG_MESSAGE_LEVEL) };
+
+// the top two bits of an id are the level, the next three the argument count
+#define VIM_LOG_ID(name, argc) \
+    ((VIM_LOG_LEVEL_##name << 14) | ((argc) << 11) | VIM_LOG_MESSAGE_##name)
+
 #ifdef VIM_DEBUG
-#    define VIM_DPRINT(s) dprint("[vim] " s)
-#    define VIM_DPRINTF(...) dprintf("[vim] " __VA_ARGS__)
+extern uint8_t vim_log_level;
+
+#    define VIM_LOG_ENABLED(level) (debug_enable && (level) <= vim_log_level)
+#    define VIM_LOG(name, ...)                                                               \
+        do {                                                                                 \
+            if (VIM_LOG_ENABLED(VIM_LOG_LEVEL_##name)) {                                     \
+                const uint16_t vim_log_args_[] = {0, ##__VA_ARGS__};                         \
+                vim_log_write(VIM_LOG_ID(name, sizeof(vim_log_args_) / 2 - 1), vim_log_args_ + 1); \
+            }                                                                                \
+        } while (0)
+
+void vim_log_write(uint16_t id, const uint16_t *args);
+void vim_log_flush(void);
 #else
-#    define VIM_DPRINT(s) ((void)0)
-#    define VIM_DPRINTF(...) ((void)0)
+#    define VIM_LOG_ENABLED(level) false
+#    define VIM_LOG(name, ...) ((void)0)
 #endif
 
+void vim_set_log_level(vim_log_level_t level);
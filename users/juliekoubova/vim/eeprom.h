@@ -0,0 +1,51 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "macro.h"
+#include "stats.h"
+
+// Layout of the EECONFIG user datablock, blocks of features that aren't
+// enabled take up no space. Make EECONFIG_USER_DATA_SIZE at least
+// VIM_EEPROM_SIZE.
+#ifdef VIM_MACRO_EEPROM
+#    define VIM_EEPROM_MACRO_SIZE VIM_MACRO_STORAGE_SIZE
+#else
+#    define VIM_EEPROM_MACRO_SIZE 0
+#endif
+
+#ifdef VIM_STATS
+#    define VIM_EEPROM_STATS_SIZE VIM_STATS_STORAGE_SIZE
+#else
+#    define VIM_EEPROM_STATS_SIZE 0
+#endif
+
+// one byte, the host tagged with VIM_HOST_EEPROM_TAG
+#ifdef VIM_HOST_EEPROM
+#    define VIM_EEPROM_HOST_SIZE 1
+#else
+#    define VIM_EEPROM_HOST_SIZE 0
+#endif
+
+#define VIM_EEPROM_MACRO_OFFSET 0
+#define VIM_EEPROM_STATS_OFFSET (VIM_EEPROM_MACRO_OFFSET + VIM_EEPROM_MACRO_SIZE)
+#define VIM_EEPROM_HOST_OFFSET (VIM_EEPROM_STATS_OFFSET + VIM_EEPROM_STATS_SIZE)
+#define VIM_EEPROM_SIZE (VIM_EEPROM_HOST_OFFSET + VIM_EEPROM_HOST_SIZE)
+
+#if defined(VIM_MACRO_EEPROM) || defined(VIM_STATS) || defined(VIM_HOST_EEPROM)
+_Static_assert(VIM_EEPROM_SIZE <= EECONFIG_USER_DATA_SIZE,
+               "EECONFIG_USER_DATA_SIZE is too small, it needs to be at least VIM_EEPROM_SIZE");
+#endif
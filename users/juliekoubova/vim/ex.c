@@ -0,0 +1,286 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ex.h"
+#include "debug.h"
+#include "host.h"
+#include "vim_mode.h"
+#include "vim_send.h"
+
+typedef enum {
+    VIM_EX_NONE,
+    VIM_EX_WRITE,
+    VIM_EX_QUIT,
+    VIM_EX_WRITE_QUIT,
+    VIM_EX_DELETE_ALL,
+    VIM_EX_NOHLSEARCH,
+    VIM_EX_BUFFER_NEXT,
+    VIM_EX_BUFFER_PREV,
+    VIM_EX_GOTO_LINE,
+    VIM_EX_PROGRAM_COUNT,
+
+    // commands below change settings instead of sending keys
+    VIM_EX_PROFILE_WINDOWS = VIM_EX_PROGRAM_COUNT,
+    VIM_EX_PROFILE_MAC,
+    VIM_EX_PROFILE_LINUX,
+} vim_ex_command_t;
+
+#define VIM_EX_PROGRAM_SIZE 2
+
+// clang-format off
+static const uint16_t vim_ex_programs[VIM_EX_PROGRAM_COUNT][VIM_HOST_COUNT][VIM_EX_PROGRAM_SIZE] PROGMEM = {
+    [VIM_EX_WRITE] = {
+        [VIM_HOST_WINDOWS] = {LCTL(KC_S)},
+        [VIM_HOST_MAC]     = {LGUI(KC_S)},
+        [VIM_HOST_LINUX]   = {LCTL(KC_S)},
+    },
+    [VIM_EX_QUIT] = {
+        [VIM_HOST_WINDOWS] = {LCTL(KC_W)},
+        [VIM_HOST_MAC]     = {LGUI(KC_W)},
+        [VIM_HOST_LINUX]   = {LCTL(KC_W)},
+    },
+    [VIM_EX_WRITE_QUIT] = {
+        [VIM_HOST_WINDOWS] = {LCTL(KC_S), LCTL(KC_W)},
+        [VIM_HOST_MAC]     = {LGUI(KC_S), LGUI(KC_W)},
+        [VIM_HOST_LINUX]   = {LCTL(KC_S), LCTL(KC_W)},
+    },
+    [VIM_EX_DELETE_ALL] = {
+        [VIM_HOST_WINDOWS] = {LCTL(KC_A), KC_DEL},
+        [VIM_HOST_MAC]     = {LGUI(KC_A), KC_DEL},
+        [VIM_HOST_LINUX]   = {LCTL(KC_A), KC_DEL},
+    },
+    [VIM_EX_NOHLSEARCH] = {
+        [VIM_HOST_WINDOWS] = {KC_ESC},
+        [VIM_HOST_MAC]     = {KC_ESC},
+        [VIM_HOST_LINUX]   = {KC_ESC},
+    },
+    [VIM_EX_BUFFER_NEXT] = {
+        [VIM_HOST_WINDOWS] = {LCTL(KC_TAB)},
+        [VIM_HOST_MAC]     = {LGUI(LSFT(KC_RBRC))},
+        [VIM_HOST_LINUX]   = {LCTL(KC_TAB)},
+    },
+    [VIM_EX_BUFFER_PREV] = {
+        [VIM_HOST_WINDOWS] = {LCTL(LSFT(KC_TAB))},
+        [VIM_HOST_MAC]     = {LGUI(LSFT(KC_LBRC))},
+        [VIM_HOST_LINUX]   = {LCTL(LSFT(KC_TAB))},
+    },
+    // followed by the line number and Enter
+    [VIM_EX_GOTO_LINE] = {
+        [VIM_HOST_WINDOWS] = {LCTL(KC_G)},
+        [VIM_HOST_MAC]     = {LCTL(KC_G)},
+        [VIM_HOST_LINUX]   = {LCTL(KC_G)},
+    },
+};
+// clang-format on
+
+typedef struct {
+    char    c;
+    uint8_t child;   // first child, 0 if none
+    uint8_t sibling; // next sibling, 0 if none
+    uint8_t command;
+} vim_ex_node_t;
+
+// Command names as a trie. Children of a node are consecutive siblings, so a
+// lookup only ever looks at the characters that can follow the prefix typed
+// so far.
+// clang-format off
+static const vim_ex_node_t vim_ex_trie[] PROGMEM = {
+    /*  0 ''                  */ {0, 1, 0, VIM_EX_NONE},
+    /*  1 'w'                 */ {'w', 8, 2, VIM_EX_WRITE},
+    /*  2 'x'                 */ {'x', 0, 3, VIM_EX_WRITE_QUIT},
+    /*  3 'q'                 */ {'q', 9, 4, VIM_EX_QUIT},
+    /*  4 '%'                 */ {'%', 10, 5, VIM_EX_NONE},
+    /*  5 'n'                 */ {'n', 11, 6, VIM_EX_NONE},
+    /*  6 'b'                 */ {'b', 12, 7, VIM_EX_NONE},
+    /*  7 's'                 */ {'s', 14, 0, VIM_EX_NONE},
+    /*  8 'wq'                */ {'q', 0, 0, VIM_EX_WRITE_QUIT},
+    /*  9 'q!'                */ {'!', 0, 0, VIM_EX_QUIT},
+    /* 10 '%d'                */ {'d', 0, 0, VIM_EX_DELETE_ALL},
+    /* 11 'no'                */ {'o', 15, 0, VIM_EX_NONE},
+    /* 12 'bn'                */ {'n', 0, 13, VIM_EX_BUFFER_NEXT},
+    /* 13 'bp'                */ {'p', 0, 0, VIM_EX_BUFFER_PREV},
+    /* 14 'se'                */ {'e', 16, 0, VIM_EX_NONE},
+    /* 15 'noh'               */ {'h', 0, 0, VIM_EX_NOHLSEARCH},
+    /* 16 'set'               */ {'t', 17, 0, VIM_EX_NONE},
+    /* 17 'set '              */ {' ', 18, 0, VIM_EX_NONE},
+    /* 18 'set p'             */ {'p', 19, 0, VIM_EX_NONE},
+    /* 19 'set pr'            */ {'r', 20, 0, VIM_EX_NONE},
+    /* 20 'set pro'           */ {'o', 21, 0, VIM_EX_NONE},
+    /* 21 'set prof'          */ {'f', 22, 0, VIM_EX_NONE},
+    /* 22 'set profi'         */ {'i', 23, 0, VIM_EX_NONE},
+    /* 23 'set profil'        */ {'l', 24, 0, VIM_EX_NONE},
+    /* 24 'set profile'       */ {'e', 25, 0, VIM_EX_NONE},
+    /* 25 'set profile='      */ {'=', 26, 0, VIM_EX_NONE},
+    /* 26 'set profile=w'     */ {'w', 29, 27, VIM_EX_NONE},
+    /* 27 'set profile=m'     */ {'m', 30, 28, VIM_EX_NONE},
+    /* 28 'set profile=l'     */ {'l', 31, 0, VIM_EX_NONE},
+    /* 29 'set profile=wi'    */ {'i', 32, 0, VIM_EX_NONE},
+    /* 30 'set profile=ma'    */ {'a', 33, 0, VIM_EX_NONE},
+    /* 31 'set profile=li'    */ {'i', 34, 0, VIM_EX_NONE},
+    /* 32 'set profile=win'   */ {'n', 0, 0, VIM_EX_PROFILE_WINDOWS},
+    /* 33 'set profile=mac'   */ {'c', 0, 0, VIM_EX_PROFILE_MAC},
+    /* 34 'set profile=lin'   */ {'n', 35, 0, VIM_EX_NONE},
+    /* 35 'set profile=linu'  */ {'u', 36, 0, VIM_EX_NONE},
+    /* 36 'set profile=linux' */ {'x', 0, 0, VIM_EX_PROFILE_LINUX},
+};
+// clang-format on
+
+static char    vim_ex_buffer[VIM_EX_BUFFER_SIZE + 1] = {0};
+static uint8_t vim_ex_length                         = 0;
+
+__attribute__((weak)) void vim_ex_changed(const char *command) {}
+
+static void vim_ex_update(void) {
+    vim_ex_buffer[vim_ex_length] = 0;
+    VIM_LOG(EX_BUFFER, vim_ex_length, vim_ex_length ? vim_ex_buffer[vim_ex_length - 1] : 0);
+    vim_ex_changed(vim_ex_buffer);
+}
+
+void vim_ex_clear(void) {
+    vim_ex_length = 0;
+    vim_ex_update();
+}
+
+const char *vim_ex_command(void) {
+    return vim_ex_buffer;
+}
+
+static uint8_t vim_ex_lookup(const char *command) {
+    uint8_t node = 0;
+    for (; *command; command++) {
+        node = pgm_read_byte(&vim_ex_trie[node].child);
+        while (node && pgm_read_byte(&vim_ex_trie[node].c) != *command) {
+            node = pgm_read_byte(&vim_ex_trie[node].sibling);
+        }
+        if (!node) {
+            return VIM_EX_NONE;
+        }
+    }
+    return pgm_read_byte(&vim_ex_trie[node].command);
+}
+
+static bool vim_ex_is_number(const char *command) {
+    if (!*command) {
+        return false;
+    }
+    for (; *command; command++) {
+        if (*command < '0' || *command > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void vim_ex_send_program(uint8_t command) {
+    const uint16_t *program = vim_ex_programs[command][vim_get_host()];
+    for (uint8_t i = 0; i < VIM_EX_PROGRAM_SIZE; i++) {
+        uint16_t code16 = pgm_read_word(&program[i]);
+        if (code16 == KC_NO) {
+            break;
+        }
+        vim_send(code16, VIM_SEND_TAP);
+    }
+}
+
+static void vim_ex_execute(void) {
+    if (vim_ex_is_number(vim_ex_buffer)) {
+        vim_ex_send_program(VIM_EX_GOTO_LINE);
+        for (const char *digit = vim_ex_buffer; *digit; digit++) {
+            vim_send(*digit == '0' ? KC_0 : KC_1 + (*digit - '1'), VIM_SEND_TAP);
+        }
+        vim_send(KC_ENTER, VIM_SEND_TAP);
+        return;
+    }
+
+    uint8_t command = vim_ex_lookup(vim_ex_buffer);
+    VIM_LOG(EX_COMMAND, command);
+    switch (command) {
+        case VIM_EX_NONE:
+            break;
+        case VIM_EX_PROFILE_WINDOWS:
+            vim_set_host(VIM_HOST_WINDOWS);
+            break;
+        case VIM_EX_PROFILE_MAC:
+            vim_set_host(VIM_HOST_MAC);
+            break;
+        case VIM_EX_PROFILE_LINUX:
+            vim_set_host(VIM_HOST_LINUX);
+            break;
+        default:
+            vim_ex_send_program(command);
+            break;
+    }
+}
+
+static char vim_ex_char(uint16_t keycode, bool shift) {
+    if (keycode >= KC_A && keycode <= KC_Z) {
+        return (shift ? 'A' : 'a') + (keycode - KC_A);
+    }
+    if (keycode >= KC_1 && keycode <= KC_9) {
+        return shift ? "!@#$%^&*("[keycode - KC_1] : '1' + (keycode - KC_1);
+    }
+    switch (keycode) {
+        case KC_0:
+            return shift ? ')' : '0';
+        case KC_SPACE:
+            return ' ';
+        case KC_MINUS:
+            return shift ? '_' : '-';
+        case KC_EQUAL:
+            return shift ? '+' : '=';
+        case KC_SEMICOLON:
+            return shift ? ':' : ';';
+        case KC_COMMA:
+            return shift ? '<' : ',';
+        case KC_DOT:
+            return shift ? '>' : '.';
+        case KC_SLASH:
+            return shift ? '?' : '/';
+        default:
+            return 0;
+    }
+}
+
+void vim_ex_process(uint16_t keycode, const keyrecord_t *record) {
+    if (!record->event.pressed) {
+        return;
+    }
+    switch (keycode) {
+        case KC_ENTER:
+            vim_ex_execute();
+            vim_enter_command_mode(true);
+            return;
+        case KC_ESCAPE:
+            vim_enter_command_mode(true);
+            return;
+        case KC_BACKSPACE:
+            if (vim_ex_length == 0) {
+                vim_enter_command_mode(true);
+                return;
+            }
+            vim_ex_length--;
+            vim_ex_update();
+            return;
+        default:
+            break;
+    }
+
+    char c = vim_ex_char(keycode, vim_get_mods() & MOD_MASK_SHIFT);
+    if (c && vim_ex_length < VIM_EX_BUFFER_SIZE) {
+        vim_ex_buffer[vim_ex_length++] = c;
+        vim_ex_update();
+    }
+}
@@ -0,0 +1,30 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdint.h>
+#include "quantum/quantum.h"
+
+#ifndef VIM_EX_BUFFER_SIZE
+#    define VIM_EX_BUFFER_SIZE 20
+#endif
+
+void        vim_ex_clear(void);
+void        vim_ex_process(uint16_t keycode, const keyrecord_t *record);
+const char *vim_ex_command(void);
+
+// Called whenever the command line changes, e.g. to show it on an OLED.
+void vim_ex_changed(const char *command);
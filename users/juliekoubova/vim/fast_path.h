@@ -0,0 +1,35 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// Every key has to go through the engine while any of these is set. In insert
+// mode with none of them set, process_record_vim returns right away.
+typedef enum {
+    VIM_SLOW_PATH_MODE   = 0x01, // not in insert mode
+    VIM_SLOW_PATH_REPEAT = 0x02, // recording the inserted text for `.`
+    VIM_SLOW_PATH_MACRO  = 0x04, // recording or playing a macro
+    VIM_SLOW_PATH_SEND   = 0x08, // typed keys have to wait for the send queue
+    VIM_SLOW_PATH_HELD   = 0x10, // a `$` held down was sent through the queue
+} vim_slow_path_t;
+
+extern uint8_t vim_slow_path;
+
+static inline void vim_set_slow_path(vim_slow_path_t reason, bool slow) {
+    vim_slow_path = slow ? (vim_slow_path | reason) : (vim_slow_path & ~reason);
+}
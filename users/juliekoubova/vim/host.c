@@ -0,0 +1,95 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "host.h"
+#include "debug.h"
+#include "eeprom.h"
+#include "quantum/quantum.h"
+#include "recorder.h"
+#include "sram.h"
+#include <string.h>
+
+#ifndef VIM_HOST
+
+// clang-format off
+static const vim_host_profile_t vim_host_profiles[VIM_HOST_COUNT] PROGMEM = {
+    [VIM_HOST_WINDOWS] = VIM_HOST_PROFILE_PC(true),
+    [VIM_HOST_MAC]     = VIM_HOST_PROFILE_MAC,
+    // GTK stops at the end of the word, like macOS
+    [VIM_HOST_LINUX]   = VIM_HOST_PROFILE_PC(false),
+};
+// clang-format on
+
+static vim_host_t vim_host = VIM_HOST_WINDOWS;
+
+// only the profile in use is kept in RAM
+static vim_host_profile_t vim_host_current = VIM_HOST_PROFILE_PC(true);
+
+static void vim_host_load(void) {
+    vim_record(VIM_RECORD_HOST, vim_host);
+    memcpy_P(&vim_host_current, &vim_host_profiles[vim_host], sizeof(vim_host_current));
+}
+
+// With VIM_HOST_EEPROM, the last host is kept in a byte of the EECONFIG user
+// datablock, so the right shortcuts are sent from a cold boot on, long before
+// OS detection finishes. The high nibble tells it from a blank or foreign byte.
+#    ifdef VIM_HOST_EEPROM
+#        define VIM_HOST_EEPROM_TAG 0xA0
+#        define VIM_HOST_EEPROM_MASK 0xF0
+_Static_assert(VIM_HOST_COUNT <= 0x10, "the host needs to fit in the low nibble");
+#    endif
+
+void vim_host_init(void) {
+#    ifdef VIM_HOST_EEPROM
+    uint8_t host;
+    eeconfig_read_user_datablock(&host, VIM_EEPROM_HOST_OFFSET, sizeof(host));
+    if ((host & VIM_HOST_EEPROM_MASK) == VIM_HOST_EEPROM_TAG &&
+        (host & ~VIM_HOST_EEPROM_MASK) < VIM_HOST_COUNT) {
+        vim_host = host & ~VIM_HOST_EEPROM_MASK;
+    }
+    VIM_LOG(HOST_EEPROM, vim_host, timer_read());
+#    endif
+    vim_host_load();
+}
+
+void vim_set_host(vim_host_t host) {
+    if (host >= VIM_HOST_COUNT) {
+        return;
+    }
+    // logged even if it didn't change, tools/vim_boot_report.py needs to know
+    // when OS detection got there
+    VIM_LOG(HOST, host, vim_host, timer_read());
+    vim_host = host;
+    vim_host_load();
+#    ifdef VIM_HOST_EEPROM
+    uint8_t tagged = VIM_HOST_EEPROM_TAG | host;
+    eeconfig_update_user_datablock(&tagged, VIM_EEPROM_HOST_OFFSET, sizeof(tagged));
+#    endif
+}
+
+vim_host_t vim_get_host(void) {
+    return vim_host;
+}
+
+const vim_host_profile_t *VIM_SRAM_FUNC(vim_host_profile)(void) {
+    return &vim_host_current;
+}
+
+#endif
+
+void vim_set_apple(bool apple) {
+    vim_set_host(apple ? VIM_HOST_MAC : VIM_HOST_WINDOWS);
+}
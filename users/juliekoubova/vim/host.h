@@ -0,0 +1,208 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "sram.h"
+
+typedef enum {
+    VIM_HOST_WINDOWS,
+    VIM_HOST_MAC,
+    VIM_HOST_LINUX,
+    VIM_HOST_COUNT,
+} vim_host_t;
+
+// Shortcuts that differ between operating systems
+typedef struct {
+    uint16_t command_mods;
+    uint16_t word_mods;
+    uint16_t document_start;
+    uint16_t document_end;
+    uint16_t line_start;
+    uint16_t line_end;
+    uint16_t paragraph_mods;
+    // Ctrl+Right stops at the start of the next word, after the space, and
+    // Ctrl+Down at the start of the next paragraph, rather than at the end of
+    // the current one
+    bool ends_at_next_start;
+    // `zz`, `zt` and `zb`, KC_NO where the host has no such shortcut
+    uint16_t view_center;
+    uint16_t view_top;
+    uint16_t view_bottom;
+    // `/`, `n` and `N`, and `*` searching for the selected word
+    uint16_t find;
+    uint16_t find_next;
+    uint16_t find_previous;
+    uint16_t find_selection;
+    // chords with these mods go to the host when they aren't mapped, e.g.
+    // Ctrl+S or Alt+Tab. Option types characters on Mac, and so does AltGr.
+    uint8_t passthrough_mods;
+    // Ctrl+V: the mods that make the arrows select a column rather than a run
+    // of text, KC_NO where the editor can't, and each line is edited in turn
+    uint16_t block_mods;
+    // the keys let through when they aren't mapped, in command mode and in
+    // the visual modes, see VIM_PASSTHROUGH_TABLE
+    const uint8_t *passthrough_command;
+    const uint8_t *passthrough_visual;
+} vim_host_profile_t;
+
+// One bit per basic keycode. A table of your own, e.g. only the F-keys in the
+// visual modes on a Mac,
+//
+//     #define MAC_VISUAL(i) VIM_PASSTHROUGH_RANGE(i, KC_F1, KC_F12)
+//     const uint8_t mac_visual[32] PROGMEM = VIM_PASSTHROUGH_TABLE(MAC_VISUAL);
+//
+// takes the place of the default with `#define VIM_HOST_MAC_PASSTHROUGH_VISUAL
+// mac_visual`. The PC ones are VIM_HOST_PC_PASSTHROUGH_COMMAND and _VISUAL.
+// clang-format off
+#define VIM_PASSTHROUGH_BIT(k, first, last) ((k) >= (first) && (k) <= (last))
+#define VIM_PASSTHROUGH_RANGE(i, first, last) ( \
+    VIM_PASSTHROUGH_BIT(8 * (i) + 0, first, last) << 0 | VIM_PASSTHROUGH_BIT(8 * (i) + 1, first, last) << 1 | \
+    VIM_PASSTHROUGH_BIT(8 * (i) + 2, first, last) << 2 | VIM_PASSTHROUGH_BIT(8 * (i) + 3, first, last) << 3 | \
+    VIM_PASSTHROUGH_BIT(8 * (i) + 4, first, last) << 4 | VIM_PASSTHROUGH_BIT(8 * (i) + 5, first, last) << 5 | \
+    VIM_PASSTHROUGH_BIT(8 * (i) + 6, first, last) << 6 | VIM_PASSTHROUGH_BIT(8 * (i) + 7, first, last) << 7)
+#define VIM_PASSTHROUGH_TABLE(F) { \
+    F(0),  F(1),  F(2),  F(3),  F(4),  F(5),  F(6),  F(7),  \
+    F(8),  F(9),  F(10), F(11), F(12), F(13), F(14), F(15), \
+    F(16), F(17), F(18), F(19), F(20), F(21), F(22), F(23), \
+    F(24), F(25), F(26), F(27), F(28), F(29), F(30), F(31), \
+}
+
+// F-keys, Print Screen, Scroll Lock and Pause, media, system and mouse keys
+#define VIM_PASSTHROUGH_ANY(i) ( \
+    VIM_PASSTHROUGH_RANGE(i, KC_F1, KC_PAUSE) | VIM_PASSTHROUGH_RANGE(i, KC_F13, KC_F24) | \
+    VIM_PASSTHROUGH_RANGE(i, KC_SYSTEM_POWER, KC_LAUNCHPAD) | VIM_PASSTHROUGH_RANGE(i, KC_MS_UP, KC_MS_ACCEL2))
+// and the arrows, Home, End, Page Up, Page Down and Delete, that would lose
+// the selection in the visual modes
+#define VIM_PASSTHROUGH_COMMAND(i) (VIM_PASSTHROUGH_ANY(i) | VIM_PASSTHROUGH_RANGE(i, KC_HOME, KC_UP))
+// clang-format on
+
+extern VIM_SRAM_CONST uint8_t vim_passthrough_command[32];
+extern VIM_SRAM_CONST uint8_t vim_passthrough_visual[32];
+
+#ifdef VIM_HOST_PC_PASSTHROUGH_COMMAND
+extern const uint8_t VIM_HOST_PC_PASSTHROUGH_COMMAND[32];
+#else
+#    define VIM_HOST_PC_PASSTHROUGH_COMMAND vim_passthrough_command
+#endif
+#ifdef VIM_HOST_PC_PASSTHROUGH_VISUAL
+extern const uint8_t VIM_HOST_PC_PASSTHROUGH_VISUAL[32];
+#else
+#    define VIM_HOST_PC_PASSTHROUGH_VISUAL vim_passthrough_visual
+#endif
+#ifdef VIM_HOST_MAC_PASSTHROUGH_COMMAND
+extern const uint8_t VIM_HOST_MAC_PASSTHROUGH_COMMAND[32];
+#else
+#    define VIM_HOST_MAC_PASSTHROUGH_COMMAND vim_passthrough_command
+#endif
+#ifdef VIM_HOST_MAC_PASSTHROUGH_VISUAL
+extern const uint8_t VIM_HOST_MAC_PASSTHROUGH_VISUAL[32];
+#else
+#    define VIM_HOST_MAC_PASSTHROUGH_VISUAL vim_passthrough_visual
+#endif
+
+// The column selection of VS Code by default. Visual Studio and Notepad++ use
+// `#define VIM_HOST_PC_BLOCK_MODS (QK_LALT | QK_LSFT)`.
+#ifndef VIM_HOST_PC_BLOCK_MODS
+#    define VIM_HOST_PC_BLOCK_MODS (QK_LCTL | QK_LALT | QK_LSFT)
+#endif
+#ifndef VIM_HOST_MAC_BLOCK_MODS
+#    define VIM_HOST_MAC_BLOCK_MODS (QK_LGUI | QK_LALT | QK_LSFT)
+#endif
+
+// clang-format off
+#define VIM_HOST_PROFILE_PC(next_start) { \
+    .command_mods        = QK_LCTL, \
+    .word_mods           = QK_LCTL, \
+    .document_start      = LCTL(KC_HOME), \
+    .document_end        = LCTL(KC_END), \
+    .line_start          = KC_HOME, \
+    .line_end            = KC_END, \
+    .paragraph_mods      = QK_LCTL, \
+    .ends_at_next_start  = (next_start), \
+    .view_center         = KC_NO, \
+    .view_top            = KC_NO, \
+    .view_bottom         = KC_NO, \
+    .find                = LCTL(KC_F), \
+    .find_next           = KC_F3, \
+    .find_previous       = LSFT(KC_F3), \
+    .find_selection      = LCTL(KC_F), \
+    .passthrough_mods    = MOD_MASK_CTRL | MOD_MASK_GUI | MOD_BIT(KC_LALT), \
+    .block_mods          = VIM_HOST_PC_BLOCK_MODS, \
+    .passthrough_command = VIM_HOST_PC_PASSTHROUGH_COMMAND, \
+    .passthrough_visual  = VIM_HOST_PC_PASSTHROUGH_VISUAL, \
+}
+
+#define VIM_HOST_PROFILE_MAC { \
+    .command_mods        = QK_LGUI, \
+    .word_mods           = QK_LALT, \
+    .document_start      = LGUI(KC_UP), \
+    .document_end        = LGUI(KC_DOWN), \
+    .line_start          = LGUI(KC_LEFT), \
+    .line_end            = LGUI(KC_RIGHT), \
+    .paragraph_mods      = QK_LALT, \
+    .ends_at_next_start  = false, \
+    .view_center         = LCTL(KC_L), \
+    .view_top            = KC_NO, \
+    .view_bottom         = KC_NO, \
+    .find                = LGUI(KC_F), \
+    .find_next           = LGUI(KC_G), \
+    .find_previous       = LGUI(LSFT(KC_G)), \
+    .find_selection      = LGUI(KC_E), \
+    .passthrough_mods    = MOD_MASK_CTRL | MOD_MASK_GUI, \
+    .block_mods          = VIM_HOST_MAC_BLOCK_MODS, \
+    .passthrough_command = VIM_HOST_MAC_PASSTHROUGH_COMMAND, \
+    .passthrough_visual  = VIM_HOST_MAC_PASSTHROUGH_VISUAL, \
+}
+// clang-format on
+
+#ifdef VIM_HOST
+// With VIM_HOST set to one of the hosts, e.g. by `VIM_HOST = mac` in rules.mk,
+// the profile is a constant, the shortcuts are folded into the code sending
+// them, and the other profiles are left out. vim_set_host doesn't do anything.
+#    include "quantum/quantum.h"
+
+static inline void vim_host_init(void) {}
+static inline void vim_set_host(vim_host_t host) {}
+
+static inline vim_host_t vim_get_host(void) {
+    return VIM_HOST;
+}
+
+static inline const vim_host_profile_t *vim_host_profile(void) {
+    static const vim_host_profile_t windows_profile = VIM_HOST_PROFILE_PC(true);
+    static const vim_host_profile_t mac_profile     = VIM_HOST_PROFILE_MAC;
+    // GTK stops at the end of the word, like macOS
+    static const vim_host_profile_t linux_profile = VIM_HOST_PROFILE_PC(false);
+    switch (VIM_HOST) {
+        case VIM_HOST_MAC:
+            return &mac_profile;
+        case VIM_HOST_LINUX:
+            return &linux_profile;
+        default:
+            return &windows_profile;
+    }
+}
+
+#else
+
+void                      vim_host_init(void);
+void                      vim_set_host(vim_host_t host);
+vim_host_t                vim_get_host(void);
+const vim_host_profile_t *vim_host_profile(void);
+
+#endif
@@ -0,0 +1,70 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "invariants.h"
+#include "debug.h"
+#include "pending.h"
+#include "quantum/quantum.h"
+#include "timer_wheel.h"
+#include "vim_mode.h"
+#include "vim_send.h"
+
+#ifdef VIM_DEBUG_INVARIANTS
+
+__attribute__((weak)) void vim_invariant_failed(vim_invariant_t invariant) {}
+
+static void vim_check(bool condition, vim_invariant_t invariant) {
+    if (!condition) {
+        VIM_LOG(INVARIANT, invariant, vim_get_mode());
+        vim_invariant_failed(invariant);
+    }
+}
+
+void vim_check_invariants(void) {
+    vim_mode_t mode = vim_get_mode();
+    vim_check(mode < VIM_MODE_COUNT, VIM_INVARIANT_MODE);
+#    ifdef VIM_NO_VLINE
+    vim_check(mode != VIM_MODE_VLINE, VIM_INVARIANT_MODE);
+#    endif
+#    ifdef VIM_NO_VBLOCK
+    vim_check(mode != VIM_MODE_VBLOCK, VIM_INVARIANT_MODE);
+#    endif
+
+    // nothing waits for a motion in insert mode, and counts stay in an int8_t
+    vim_pending_t pending = vim_get_pending();
+    vim_check(mode != VIM_MODE_INSERT || !vim_has_pending(), VIM_INVARIANT_PENDING);
+    vim_check(pending.repeat <= INT8_MAX, VIM_INVARIANT_PENDING);
+    vim_check(pending.argument == VIM_ACTION_NONE || pending.argument < VIM_ACTION_COUNT,
+              VIM_INVARIANT_PENDING);
+#    if !defined(VIM_PENDING_TIMEOUT) || VIM_PENDING_TIMEOUT > 0
+    vim_check(vim_has_pending() == vim_timer_is_scheduled(VIM_TIMER_PENDING),
+              VIM_INVARIANT_PENDING_TIMER);
+#    endif
+
+    // the mods held in command mode are handed back to the host in insert mode
+    vim_check(VIM_PASSES_KEYS(mode) ? vim_get_mods() == 0 : true, VIM_INVARIANT_INSERT_MODS);
+
+    if (vim_send_busy()) {
+        vim_check(vim_timer_is_scheduled(VIM_TIMER_EMIT), VIM_INVARIANT_SEND_TIMER);
+    } else if (!VIM_PASSES_KEYS(mode)) {
+        // once everything is sent, the host only sees the mods of a held motion,
+        // never the ones held on the keyboard
+        vim_check(get_mods() == QK_MODS_GET_MODS(vim_send_get_held()) && !get_weak_mods(),
+                  VIM_INVARIANT_HOST_MODS);
+    }
+}
+
+#endif
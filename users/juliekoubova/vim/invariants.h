@@ -0,0 +1,42 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdint.h>
+
+// With VIM_DEBUG_INVARIANTS, the state of Vim mode is checked after every key
+// and every task, and anything that can't be right is logged as an error. A
+// test harness built on top of stubbed QMK functions can override
+// vim_invariant_failed to stop right where things went wrong.
+typedef enum {
+    VIM_INVARIANT_MODE,
+    VIM_INVARIANT_PENDING,
+    VIM_INVARIANT_PENDING_TIMER,
+    VIM_INVARIANT_INSERT_MODS,
+    VIM_INVARIANT_HOST_MODS,
+    VIM_INVARIANT_SEND_TIMER,
+} vim_invariant_t;
+
+#ifdef VIM_DEBUG_INVARIANTS
+
+void vim_invariant_failed(vim_invariant_t invariant);
+void vim_check_invariants(void);
+
+#else
+
+static inline void vim_check_invariants(void) {}
+
+#endif
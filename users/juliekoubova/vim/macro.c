@@ -0,0 +1,324 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "macro.h"
+#include "debug.h"
+#include "eeprom.h"
+#include "fast_path.h"
+#include "pending.h"
+#include "timer_wheel.h"
+#include "vim_mode.h"
+#include "vim_send.h"
+#include <string.h>
+
+#ifndef VIM_MACRO_EVENT_DELAY
+#    define VIM_MACRO_EVENT_DELAY VIM_TAP_DELAY
+#endif
+
+#define VIM_MACRO_REGISTER(keycode) ((keycode) - KC_A)
+#define VIM_MACRO_NONE 0xff
+#define VIM_MACRO_MAX_HELD 6
+
+// Key events are stored one byte each for keycodes up to 0x7f, with the top
+// bit set for releases. Anything else (modifiers, the vim key, layer keys) is
+// stored as an escape byte followed by the big-endian keycode, again with the
+// top bit set for releases.
+#define VIM_MACRO_ESCAPE 0x00
+#define VIM_MACRO_RELEASE 0x80
+#define VIM_MACRO_RELEASE16 0x8000
+
+typedef struct {
+    uint16_t offset;
+    uint16_t length;
+} vim_macro_register_t;
+
+typedef struct {
+    uint16_t             magic;
+    vim_macro_register_t registers[VIM_MACRO_REGISTERS];
+    uint16_t             used;
+    uint8_t              arena[VIM_MACRO_ARENA_SIZE];
+} vim_macros_t;
+
+#define VIM_MACRO_MAGIC (0x7600 ^ VIM_MACRO_ARENA_SIZE)
+
+_Static_assert(sizeof(vim_macros_t) == VIM_MACRO_STORAGE_SIZE, "update VIM_MACRO_STORAGE_SIZE");
+
+typedef struct {
+    uint8_t  reg;
+    uint8_t  repeat;
+    uint16_t position;
+    uint8_t  held_count;
+    uint16_t held[VIM_MACRO_MAX_HELD];
+} vim_macro_player_t;
+
+static vim_macros_t       vim_macros    = {0};
+static vim_macro_player_t vim_player    = {.reg = VIM_MACRO_NONE};
+static uint8_t            vim_recording = VIM_MACRO_NONE;
+static uint8_t            vim_last_play = VIM_MACRO_NONE;
+
+static void vim_macro_tick(void);
+
+static void vim_macro_update_slow_path(void) {
+    vim_set_slow_path(VIM_SLOW_PATH_MACRO,
+                      vim_recording != VIM_MACRO_NONE || vim_player.reg != VIM_MACRO_NONE);
+}
+
+static bool vim_macro_is_register(uint16_t keycode) {
+    return keycode >= KC_A && keycode <= KC_Z;
+}
+
+static void vim_macro_clear(void) {
+    memset(&vim_macros, 0, sizeof(vim_macros));
+    vim_macros.magic = VIM_MACRO_MAGIC;
+}
+
+void vim_macro_init(void) {
+#ifdef VIM_MACRO_EEPROM
+    eeconfig_read_user_datablock(&vim_macros, VIM_EEPROM_MACRO_OFFSET, sizeof(vim_macros));
+    if (vim_macros.magic == VIM_MACRO_MAGIC && vim_macros.used <= VIM_MACRO_ARENA_SIZE) {
+        vim_macro_log_usage();
+        return;
+    }
+    VIM_LOG(MACRO_EEPROM_INVALID);
+#endif
+    vim_macro_clear();
+}
+
+static void vim_macro_save(void) {
+#ifdef VIM_MACRO_EEPROM
+    eeconfig_update_user_datablock(&vim_macros, VIM_EEPROM_MACRO_OFFSET, sizeof(vim_macros));
+#endif
+}
+
+static void vim_macro_reverse(uint8_t *start, uint8_t *end) {
+    while (start < end) {
+        uint8_t byte = *start;
+        *start++     = *--end;
+        *end         = byte;
+    }
+}
+
+// Moves the register to the end of the arena, closing the gap it leaves
+// behind, so that the recording can grow in place. The move is a rotation of
+// everything behind the register start, done by reversing in place.
+static void vim_macro_move_to_end(uint8_t reg) {
+    vim_macro_register_t *target = &vim_macros.registers[reg];
+    uint16_t              end    = target->offset + target->length;
+    if (target->length > 0 && end != vim_macros.used) {
+        uint8_t *arena = vim_macros.arena;
+        vim_macro_reverse(&arena[target->offset], &arena[end]);
+        vim_macro_reverse(&arena[end], &arena[vim_macros.used]);
+        vim_macro_reverse(&arena[target->offset], &arena[vim_macros.used]);
+        for (uint8_t i = 0; i < VIM_MACRO_REGISTERS; i++) {
+            if (vim_macros.registers[i].offset >= end) {
+                vim_macros.registers[i].offset -= target->length;
+            }
+        }
+    }
+    target->offset = vim_macros.used - target->length;
+}
+
+void vim_macro_record(uint16_t keycode, bool append) {
+    if (!vim_macro_is_register(keycode) || vim_player.reg != VIM_MACRO_NONE) {
+        return;
+    }
+    uint8_t reg = VIM_MACRO_REGISTER(keycode);
+    vim_macro_move_to_end(reg);
+    if (!append) {
+        vim_macros.used -= vim_macros.registers[reg].length;
+        vim_macros.registers[reg].length = 0;
+    }
+    vim_recording = reg;
+    vim_macro_update_slow_path();
+    VIM_LOG(MACRO_RECORD, 'a' + reg);
+}
+
+static void vim_macro_stop_recording(void) {
+    VIM_LOG(MACRO_STOP, 'a' + vim_recording);
+    vim_recording = VIM_MACRO_NONE;
+    vim_macro_update_slow_path();
+    vim_macro_log_usage();
+    vim_macro_save();
+}
+
+// Stops recording and empties every register, the saved ones too. A macro
+// still playing only releases what it holds.
+void vim_macro_forget(void) {
+    vim_recording = VIM_MACRO_NONE;
+    vim_last_play = VIM_MACRO_NONE;
+    vim_macro_clear();
+    vim_macro_update_slow_path();
+    vim_macro_save();
+}
+
+static void vim_macro_append(uint16_t keycode, bool pressed) {
+    vim_macro_register_t *target = &vim_macros.registers[vim_recording];
+    uint8_t               bytes  = keycode > 0 && keycode < VIM_MACRO_RELEASE ? 1 : 3;
+    if (vim_macros.used + bytes > VIM_MACRO_ARENA_SIZE) {
+        VIM_LOG(MACRO_FULL);
+        vim_macro_stop_recording();
+        return;
+    }
+
+    uint8_t *data = &vim_macros.arena[vim_macros.used];
+    if (bytes == 1) {
+        data[0] = keycode | (pressed ? 0 : VIM_MACRO_RELEASE);
+    } else {
+        keycode |= pressed ? 0 : VIM_MACRO_RELEASE16;
+        data[0] = VIM_MACRO_ESCAPE;
+        data[1] = keycode >> 8;
+        data[2] = keycode & 0xff;
+    }
+    target->length += bytes;
+    vim_macros.used += bytes;
+}
+
+bool vim_macro_process_record(uint16_t keycode, const keyrecord_t *record) {
+    if (vim_player.reg != VIM_MACRO_NONE && record->event.pressed) {
+        VIM_LOG(MACRO_INTERRUPTED);
+        vim_player.repeat   = 0;
+        vim_player.position = vim_macros.registers[vim_player.reg].length;
+    }
+
+    if (vim_recording == VIM_MACRO_NONE) {
+        return true;
+    }
+
+    if (record->event.pressed && keycode == KC_Q && vim_get_mode() == VIM_MODE_COMMAND &&
+        !vim_has_pending() && vim_get_mods() == 0) {
+        vim_macro_stop_recording();
+        return false;
+    }
+
+    // the release of the register name key would otherwise start the macro
+    if (!record->event.pressed && vim_macros.registers[vim_recording].length == 0) {
+        return true;
+    }
+
+    vim_macro_append(keycode, record->event.pressed);
+    return true;
+}
+
+void vim_macro_play(uint16_t keycode, uint8_t repeat) {
+    if (!vim_macro_is_register(keycode)) {
+        return;
+    }
+    uint8_t reg = VIM_MACRO_REGISTER(keycode);
+    if (reg == vim_recording || vim_player.reg != VIM_MACRO_NONE) {
+        VIM_LOG(MACRO_BUSY, 'a' + reg);
+        return;
+    }
+    VIM_LOG(MACRO_PLAY, 'a' + reg, repeat);
+    vim_last_play         = reg;
+    vim_player.reg        = reg;
+    vim_player.repeat     = repeat > 0 ? repeat : 1;
+    vim_player.position   = 0;
+    vim_player.held_count = 0;
+    vim_macro_update_slow_path();
+    vim_timer_schedule(VIM_TIMER_MACRO, 0, vim_macro_tick);
+}
+
+void vim_macro_play_last(uint8_t repeat) {
+    if (vim_last_play != VIM_MACRO_NONE) {
+        vim_macro_play(KC_A + vim_last_play, repeat);
+    }
+}
+
+bool vim_macro_is_playing(void) {
+    return vim_player.reg != VIM_MACRO_NONE;
+}
+
+static void vim_macro_track_held(uint16_t keycode, bool pressed) {
+    for (uint8_t i = 0; i < vim_player.held_count; i++) {
+        if (vim_player.held[i] == keycode) {
+            if (!pressed) {
+                vim_player.held[i] = vim_player.held[--vim_player.held_count];
+            }
+            return;
+        }
+    }
+    if (pressed && vim_player.held_count < VIM_MACRO_MAX_HELD) {
+        vim_player.held[vim_player.held_count++] = keycode;
+    }
+}
+
+// Returns the next key event to be replayed, if any is due. When the playback
+// is over, or has been interrupted, releases the keys it left pressed first.
+static bool vim_macro_next_event(uint16_t *keycode, bool *pressed) {
+    if (vim_player.reg == VIM_MACRO_NONE) {
+        return false;
+    }
+
+    const vim_macro_register_t *source = &vim_macros.registers[vim_player.reg];
+    if (vim_player.position >= source->length && vim_player.repeat > 1) {
+        vim_player.repeat--;
+        vim_player.position = 0;
+    }
+
+    if (vim_player.position >= source->length) {
+        if (vim_player.held_count == 0) {
+            VIM_LOG(MACRO_FINISHED);
+            vim_player.reg = VIM_MACRO_NONE;
+            vim_macro_update_slow_path();
+            return false;
+        }
+        *keycode = vim_player.held[--vim_player.held_count];
+        *pressed = false;
+    } else {
+        const uint8_t *data = &vim_macros.arena[source->offset + vim_player.position];
+        if (data[0] == VIM_MACRO_ESCAPE) {
+            uint16_t code16 = (data[1] << 8) | data[2];
+            *keycode        = code16 & ~VIM_MACRO_RELEASE16;
+            *pressed        = !(code16 & VIM_MACRO_RELEASE16);
+            vim_player.position += 3;
+        } else {
+            *keycode = data[0] & ~VIM_MACRO_RELEASE;
+            *pressed = !(data[0] & VIM_MACRO_RELEASE);
+            vim_player.position += 1;
+        }
+        vim_macro_track_held(*keycode, *pressed);
+    }
+    return true;
+}
+
+// Plays an event every VIM_MACRO_EVENT_DELAY, but only once all the keys sent
+// for the previous one are out.
+static void vim_macro_tick(void) {
+    if (vim_send_busy()) {
+        vim_timer_schedule(VIM_TIMER_MACRO, 0, vim_macro_tick);
+        return;
+    }
+    uint16_t keycode;
+    bool     pressed;
+    if (vim_macro_next_event(&keycode, &pressed)) {
+        vim_macro_feed(keycode, pressed);
+        vim_timer_schedule(VIM_TIMER_MACRO, VIM_MACRO_EVENT_DELAY, vim_macro_tick);
+    }
+}
+
+uint16_t vim_macro_register_size(uint16_t keycode) {
+    return vim_macro_is_register(keycode) ? vim_macros.registers[VIM_MACRO_REGISTER(keycode)].length
+                                          : 0;
+}
+
+void vim_macro_log_usage(void) {
+    for (uint8_t i = 0; i < VIM_MACRO_REGISTERS; i++) {
+        if (vim_macros.registers[i].length) {
+            VIM_LOG(MACRO_REGISTER_SIZE, 'a' + i, vim_macros.registers[i].length);
+        }
+    }
+    VIM_LOG(MACRO_USAGE, vim_macros.used, VIM_MACRO_ARENA_SIZE);
+}
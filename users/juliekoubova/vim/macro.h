@@ -0,0 +1,47 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "minimal.h"
+#include "quantum/quantum.h"
+
+#ifndef VIM_MACRO_ARENA_SIZE
+#    define VIM_MACRO_ARENA_SIZE 256
+#endif
+
+#define VIM_MACRO_REGISTERS (KC_Z - KC_A + 1)
+
+// what VIM_MACRO_EEPROM takes up in the EECONFIG user datablock
+#define VIM_MACRO_STORAGE_SIZE (4 + 4 * VIM_MACRO_REGISTERS + VIM_MACRO_ARENA_SIZE)
+
+void vim_macro_init(void);
+
+// Returns false when the key event has been consumed by the macro recorder
+bool vim_macro_process_record(uint16_t keycode, const keyrecord_t *record);
+
+void vim_macro_record(uint16_t keycode, bool append);
+void vim_macro_play(uint16_t keycode, uint8_t repeat);
+void vim_macro_play_last(uint8_t repeat);
+bool vim_macro_is_playing(void);
+void vim_macro_forget(void);
+
+// Implemented by vim.c, feeds a played event through the engine
+void vim_macro_feed(uint16_t keycode, bool pressed);
+
+uint16_t vim_macro_register_size(uint16_t keycode);
+void     vim_macro_log_usage(void);
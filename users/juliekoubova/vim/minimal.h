@@ -0,0 +1,37 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// VIM_MINIMAL trims Vim mode down to fit an ATmega32U4 next to the rest of the
+// firmware: smaller buffers, and none of the debugging features. Anything set
+// in config.h still wins. Add VIM_NO_VLINE and VIM_NO_VBLOCK to also leave out
+// v-line and v-block mode.
+#ifdef VIM_MINIMAL
+#    if defined(VIM_DEBUG) || defined(VIM_DEBUG_INVARIANTS) || defined(VIM_PROFILE) || \
+        defined(VIM_STATS) || defined(VIM_RECORDER)
+#        error "VIM_MINIMAL leaves out VIM_DEBUG, VIM_DEBUG_INVARIANTS, VIM_PROFILE, VIM_STATS and VIM_RECORDER"
+#    endif
+#    ifndef VIM_SEND_QUEUE_SIZE
+#        define VIM_SEND_QUEUE_SIZE 16
+#    endif
+#    ifndef VIM_REPEAT_BUFFER_SIZE
+#        define VIM_REPEAT_BUFFER_SIZE 16
+#    endif
+#    ifndef VIM_MACRO_ARENA_SIZE
+#        define VIM_MACRO_ARENA_SIZE 64
+#    endif
+#endif
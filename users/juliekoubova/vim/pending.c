@@ -17,45 +17,91 @@
 #include "pending.h"
 #include "debug.h"
 #include "quantum/quantum.h"
+#include "sram.h"
+#include "stats.h"
+#include "timer_wheel.h"
 #include <stdint.h>
 
-#ifndef VIM_PENDING_MAX_REPEAT
-#    define VIM_PENDING_MAX_REPEAT 10
+// Counts are sent as an int8_t, larger ones are capped.
+#ifndef VIM_PENDING_MAX_COUNT
+#    define VIM_PENDING_MAX_COUNT INT8_MAX
 #endif
 
-static vim_pending_t vim_pending = {KC_NO, 0};
+// A count or an operator that isn't followed by a motion within this many
+// milliseconds is dropped, so a stray `d` doesn't wait forever. 0 disables it.
+#ifndef VIM_PENDING_TIMEOUT
+#    define VIM_PENDING_TIMEOUT 2000
+#endif
+
+static vim_pending_t vim_pending = {KC_NO, 0, VIM_ACTION_NONE};
+
+static void vim_pending_timed_out(void) {
+    VIM_LOG(PENDING_TIMEOUT);
+    vim_stats_abandoned();
+    vim_clear_pending();
+}
+
+static void vim_pending_changed(void) {
+    VIM_LOG(PENDING, vim_pending.repeat, vim_pending.keycode, vim_pending.argument);
+#if VIM_PENDING_TIMEOUT > 0
+    vim_timer_schedule(VIM_TIMER_PENDING, VIM_PENDING_TIMEOUT, vim_pending_timed_out);
+#endif
+}
 
-static void vim_dprintf_pending(void) {
-    VIM_DPRINTF("pending repeat=%d keycode=%x\n", vim_pending.repeat, vim_pending.keycode);
+static void vim_append_digit(uint8_t digit) {
+    uint16_t repeat    = vim_pending.repeat * 10 + digit;
+    vim_pending.repeat = repeat > VIM_PENDING_MAX_COUNT ? VIM_PENDING_MAX_COUNT : repeat;
 }
 
 void vim_append_pending(uint8_t keycode) {
     if (keycode == KC_0) {
-        if (vim_pending.repeat > 0) {
-            vim_pending.repeat *= 10;
+        if (vim_pending.repeat == 0) {
+            // not a count, and v-line mode has no use for it as a motion
+            return;
         }
+        vim_append_digit(0);
     } else if (keycode >= KC_1 && keycode <= KC_9) {
-        vim_pending.repeat *= 10;
-        vim_pending.repeat += 1 + (keycode - KC_1);
+        vim_append_digit(1 + (keycode - KC_1));
     } else {
         vim_pending.keycode = keycode;
     }
-    vim_dprintf_pending();
+    vim_pending_changed();
+}
+
+// The next key pressed won't be looked up in the state machine, but passed as
+// an argument to the action instead (e.g. the register name after `q`).
+void vim_set_pending_argument(vim_action_t action) {
+    vim_pending.argument = action;
+    vim_pending_changed();
+}
+
+// `c`, `d` and `y` wait for a motion or a text object
+bool vim_is_operator(uint8_t keycode) {
+    return keycode == KC_C || keycode == KC_D || keycode == KC_Y;
 }
 
 vim_pending_t vim_clear_pending(void) {
-    VIM_DPRINT("vim_clear_pending\n");
-    vim_dprintf_pending();
+    VIM_LOG(PENDING_CLEAR);
+    vim_timer_cancel(VIM_TIMER_PENDING);
     vim_pending_t previous = vim_pending;
     vim_pending.repeat     = 0;
     vim_pending.keycode    = KC_NO;
+    vim_pending.argument   = VIM_ACTION_NONE;
     return previous;
 }
 
-vim_pending_t vim_get_pending(void) {
+vim_pending_t VIM_SRAM_FUNC(vim_get_pending)(void) {
     return vim_pending;
 }
 
-bool vim_has_pending(void) {
-    return vim_pending.repeat > 0 || vim_pending.keycode != KC_NO;
+void vim_restore_pending(vim_pending_t pending) {
+    vim_pending = pending;
+    if (vim_has_pending()) {
+        vim_pending_changed();
+    }
+}
+
+bool VIM_SRAM_FUNC(vim_has_pending)(void) {
+    return vim_pending.repeat > 0 || vim_pending.keycode != KC_NO ||
+           vim_pending.argument != VIM_ACTION_NONE;
 }
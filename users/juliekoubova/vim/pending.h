@@ -20,12 +20,16 @@
 #include "statemachine.h"
 
 typedef struct {
-    uint8_t keycode;
-    uint8_t repeat;
+    uint8_t      keycode;
+    uint8_t      repeat;
+    vim_action_t argument;
 } vim_pending_t;
 
 void vim_append_pending(uint8_t keycode);
+void vim_set_pending_argument(vim_action_t action);
 bool vim_has_pending(void);
+bool vim_is_operator(uint8_t keycode);
 
 vim_pending_t vim_clear_pending(void);
 vim_pending_t vim_get_pending(void);
+void          vim_restore_pending(vim_pending_t pending);
@@ -15,76 +15,235 @@
  */
 
 #include "debug.h"
+#include "host.h"
+#include "macro.h"
 #include "pending.h"
 #include "perform_action.h"
 #include "quantum/keycode.h"
 #include "platforms/timer.h"
+#include "profile.h"
+#include "repeat.h"
+#include "search.h"
+#include "selection.h"
+#include "sram.h"
 #include "statemachine.h"
+#include "stats.h"
 #include "vim_mode.h"
 #include "vim_send.h"
 #include <stdbool.h>
 
-static uint16_t command_mods   = QK_LCTL;
-static uint16_t word_mods      = QK_LCTL;
-static uint16_t document_start = LCTL(KC_HOME);
-static uint16_t document_end   = LCTL(KC_END);
-static uint16_t line_start     = KC_HOME;
-static uint16_t line_end       = KC_END;
-
-typedef enum { VLINE_DOWN_ASSUMED, VLINE_DOWN, VLINE_UP } vline_t;
-
-static vline_t vline = VLINE_DOWN_ASSUMED;
-
-// if we start vline mode going up, we start the selection from the end of the
-// line and select all the way to the start of line after each key release. that
-// way, when we get to the beginning of the document, we select the first line
-// completely. and vice versa for going down.
-// if we first go in one direction, then decide to go in the other and
-// overshoot the original starting point, this will stop working, but hey, at
-// least we tried.
-static void vim_vline_start(vline_t direction) {
-    uint8_t first  = direction == VLINE_UP ? line_end : line_start;
-    uint8_t second = direction == VLINE_UP ? line_start : line_end;
-    vim_send(first, VIM_SEND_TAP);
-    vim_send(LSFT(second), VIM_SEND_TAP);
-    vline = direction;
+// wheel detents scrolled by Ctrl+D and Ctrl+U, Ctrl+E and Ctrl+Y scroll one
+#ifndef VIM_SCROLL_HALF_PAGE
+#    define VIM_SCROLL_HALF_PAGE 5
+#endif
+
+// `iw`, `aw`, `ip` and `ap` are selected with the host's word and paragraph
+// motions. Going forward and back first finds the start of the object, even
+// from its first character. Quotes and brackets can't be found without
+// reading the text, so `i"` and `a(` don't do anything.
+void vim_perform_object(uint16_t keycode, vim_action_t object, vim_pending_t pending) {
+    const vim_host_profile_t *host   = vim_host_profile();
+    bool                      around = (object & VIM_MASK_ACTION) == VIM_ACTION_OBJECT_AROUND;
+    uint16_t                  backward, forward;
+    switch (keycode) {
+        case KC_W:
+            backward = host->word_mods | KC_LEFT;
+            forward  = host->word_mods | KC_RIGHT;
+            break;
+        case KC_P:
+            backward = host->paragraph_mods | KC_UP;
+            forward  = host->paragraph_mods | KC_DOWN;
+            break;
+        default:
+            return;
+    }
+    vim_repeat_record_object(keycode, object, pending);
+    vim_send(forward, VIM_SEND_TAP);
+    vim_send(backward, VIM_SEND_TAP);
+    vim_send_repeated(pending.repeat ? pending.repeat : 1, forward | QK_LSFT, VIM_SEND_TAP);
+    // the space or newline after the object belongs to `aw` and `ap` only
+    if (host->ends_at_next_start && !around) {
+        vim_send(LSFT(KC_LEFT), VIM_SEND_TAP);
+    } else if (!host->ends_at_next_start && around) {
+        vim_send(LSFT(KC_RIGHT), VIM_SEND_TAP);
+    }
+
+    switch (pending.keycode) {
+        case KC_C:
+            vim_send(host->command_mods | KC_X, VIM_SEND_TAP);
+            vim_enter_insert_mode();
+            break;
+        case KC_D:
+            vim_send(host->command_mods | KC_X, VIM_SEND_TAP);
+            break;
+        case KC_Y:
+            vim_send(host->command_mods | KC_C, VIM_SEND_TAP);
+            vim_send(KC_LEFT, VIM_SEND_TAP);
+            break;
+        default:
+            // `viw` leaves the object selected
+            vim_selection_motion(VIM_ACTION_WORD_END | VIM_MOD_SELECT, 1, VIM_SEND_TAP);
+            break;
+    }
 }
 
-void vim_vline_entered(void) {
-    // begin vline mode assuming we're gonna go down
-    vim_vline_start(VLINE_DOWN_ASSUMED);
+// `zz`, `zt` and `zb` need a shortcut of the host, most only have `zz`, if any
+static void vim_perform_view(uint16_t keycode) {
+    const vim_host_profile_t *host   = vim_host_profile();
+    uint16_t                  code16 = KC_NO;
+    switch (keycode) {
+        case KC_Z:
+            code16 = host->view_center;
+            break;
+        case KC_T:
+            code16 = host->view_top;
+            break;
+        case KC_B:
+            code16 = host->view_bottom;
+            break;
+        default:
+            break;
+    }
+    if (code16 != KC_NO) {
+        vim_send(code16, VIM_SEND_TAP);
+    }
 }
 
-void vim_set_apple(bool apple) {
-    VIM_DPRINTF("apple=%d\n", apple);
-    command_mods   = apple ? QK_LGUI : QK_LCTL;
-    word_mods      = apple ? QK_LALT : QK_LCTL;
-    document_start = apple ? LGUI(KC_UP) : LCTL(KC_HOME);
-    document_end   = apple ? LGUI(KC_DOWN) : LCTL(KC_END);
-    line_start     = apple ? LGUI(KC_LEFT) : KC_HOME;
-    line_end       = apple ? LGUI(KC_RIGHT) : KC_END;
+void vim_perform_argument(uint16_t keycode) {
+    vim_pending_t pending = vim_clear_pending();
+    bool          shift   = vim_get_mods() & MOD_MASK_SHIFT;
+    vim_stats_action(pending.argument, pending);
+    switch (pending.argument & VIM_MASK_ACTION) {
+        case VIM_ACTION_MACRO_RECORD:
+            // `qA` appends to register a
+            vim_macro_record(keycode, shift);
+            break;
+        case VIM_ACTION_MACRO_PLAY:
+            if (keycode == KC_2 && shift) {
+                vim_macro_play_last(pending.repeat);
+            } else {
+                vim_macro_play(keycode, pending.repeat);
+            }
+            break;
+        case VIM_ACTION_OBJECT_INNER:
+        case VIM_ACTION_OBJECT_AROUND:
+            vim_perform_object(keycode, pending.argument, pending);
+            break;
+        case VIM_ACTION_VIEW:
+            vim_perform_view(keycode);
+            break;
+        default:
+            break;
+    }
 }
 
-void vim_perform_action(vim_action_t action, vim_send_type_t type) {
+void VIM_SRAM_FUNC(vim_perform_action)(vim_action_t action, vim_send_type_t type) {
+    VIM_PROFILE_BEGIN(perform_action);
     vim_pending_t pending = vim_clear_pending();
+    if (pending.keycode == KC_G && action == VIM_ENTER_VISUAL) {
+        // `gv`
+        action          = VIM_ACTION_RESELECT;
+        pending.keycode = KC_NO;
+    }
+    if (type & VIM_SEND_PRESS) {
+        vim_stats_action(action, pending);
+    }
+    vim_perform_pending_action(action, type, pending);
+    VIM_PROFILE_END(perform_action, VIM_PROBE_PERFORM_ACTION);
+}
+
+void VIM_SRAM_FUNC(vim_perform_pending_action)(vim_action_t action, vim_send_type_t type,
+                                                vim_pending_t pending) {
+    const vim_host_profile_t *host = vim_host_profile();
+
+#ifndef VIM_NO_VLINE
+    vim_vline_fixup_now(action);
+#endif
+
+    if ((action & VIM_MASK_ACTION) == VIM_ACTION_REPEAT) {
+        vim_repeat_replay(pending.repeat);
+        return;
+    }
+    if (type & VIM_SEND_PRESS) {
+        vim_repeat_record(action, pending);
+    }
+
     switch (action & VIM_MASK_ACTION) {
         case VIM_ACTION_OPEN_LINE_DOWN:
-            vim_send(line_end, VIM_SEND_TAP);
+            vim_send(host->line_end, VIM_SEND_TAP);
             vim_send(KC_ENTER, VIM_SEND_TAP);
             vim_enter_insert_mode();
             return;
         case VIM_ACTION_OPEN_LINE_UP:
-            vim_send(line_start, VIM_SEND_TAP);
+            vim_send(host->line_start, VIM_SEND_TAP);
             vim_send(KC_ENTER, VIM_SEND_TAP);
             vim_send(KC_UP, VIM_SEND_TAP);
             vim_enter_insert_mode();
             return;
+        case VIM_ACTION_SWAP_ENDS:
+            vim_selection_swap();
+            return;
+        case VIM_ACTION_RESELECT:
+            vim_selection_reselect();
+            return;
+#ifdef MOUSE_ENABLE
+        // one or two wheel reports, instead of a tap for every line
+        case VIM_ACTION_SCROLL_DOWN:
+        case VIM_ACTION_SCROLL_UP:
+        case VIM_ACTION_HALF_PAGE_DOWN:
+        case VIM_ACTION_HALF_PAGE_UP: {
+            vim_action_t scroll  = action & VIM_MASK_ACTION;
+            int16_t      detents = pending.repeat ? pending.repeat : 1;
+            if (scroll == VIM_ACTION_HALF_PAGE_DOWN || scroll == VIM_ACTION_HALF_PAGE_UP) {
+                detents *= VIM_SCROLL_HALF_PAGE;
+            }
+            if (scroll == VIM_ACTION_SCROLL_DOWN || scroll == VIM_ACTION_HALF_PAGE_DOWN) {
+                detents = -detents;
+            }
+            vim_send_wheel(detents);
+            return;
+        }
+#endif
+        // the host can't select up to a match, so `d/` and `dn` are dropped
+        case VIM_ACTION_SEARCH:
+        case VIM_ACTION_SEARCH_BACKWARD:
+            if (!vim_is_operator(pending.keycode)) {
+                vim_search_start((action & VIM_MASK_ACTION) == VIM_ACTION_SEARCH_BACKWARD);
+            }
+            return;
+        case VIM_ACTION_SEARCH_NEXT:
+        case VIM_ACTION_SEARCH_PREVIOUS:
+            if (!vim_is_operator(pending.keycode)) {
+                vim_search_next((action & VIM_MASK_ACTION) == VIM_ACTION_SEARCH_PREVIOUS,
+                                pending.repeat ? pending.repeat : 1);
+            }
+            return;
+        case VIM_ACTION_SEARCH_WORD:
+        case VIM_ACTION_SEARCH_WORD_BACKWARD:
+            if (!vim_is_operator(pending.keycode)) {
+                vim_search_word((action & VIM_MASK_ACTION) == VIM_ACTION_SEARCH_WORD_BACKWARD,
+                                pending.repeat ? pending.repeat : 1);
+            }
+            return;
         default:
             break;
     }
 
+#ifndef VIM_NO_VBLOCK
+    if ((action & VIM_MASK_ACTION) == VIM_ACTION_SELECTION && vim_get_mode() == VIM_MODE_VBLOCK) {
+        vim_block_perform(action);
+        vim_enter_mode(VIM_MODE_FROM_ACTION(action), true);
+        return;
+    }
+#endif
+
+    // an operator followed by a key that isn't a motion is dropped, instead of
+    // cutting whatever the host has selected
+    if ((action & VIM_MASK_ACTION) == VIM_ACTION_NONE && vim_is_operator(pending.keycode)) {
+        pending.keycode = KC_NO;
+    }
+
     uint16_t code16[3]         = {KC_NO, KC_NO, KC_NO};
-    vline_t  next_vline        = VLINE_DOWN_ASSUMED;
     bool     selection_cleared = false;
 
     switch (action & VIM_MASK_ACTION) {
@@ -107,54 +266,48 @@ void vim_perform_action(vim_action_t action, vim_send_type_t type) {
             }
             break;
         case VIM_ACTION_DOWN:
-            *code16    = KC_DOWN;
-            next_vline = VLINE_DOWN;
+            *code16 = KC_DOWN;
             break;
         case VIM_ACTION_UP:
-            *code16    = KC_UP;
-            next_vline = VLINE_UP;
+            *code16 = KC_UP;
             break;
         case VIM_ACTION_LINE_START:
-            *code16 = line_start;
+            *code16 = host->line_start;
             break;
         case VIM_ACTION_LINE_END:
-            *code16 = line_end;
+            *code16 = host->line_end;
             break;
         case VIM_ACTION_WORD_START:
-            *code16 = word_mods | KC_LEFT;
+            *code16 = host->word_mods | KC_LEFT;
             break;
         case VIM_ACTION_WORD_END:
-            *code16 = word_mods | KC_RIGHT;
+            *code16 = host->word_mods | KC_RIGHT;
             break;
         case VIM_ACTION_DOCUMENT_START:
-            *code16    = document_start;
-            next_vline = VLINE_UP;
+            *code16 = host->document_start;
             break;
         case VIM_ACTION_DOCUMENT_END:
-            *code16    = document_end;
-            next_vline = VLINE_DOWN;
+            *code16 = host->document_end;
             break;
         case VIM_ACTION_PAGE_UP:
             *code16         = KC_PAGE_UP;
-            next_vline      = VLINE_UP;
             pending.keycode = KC_NO;
             break;
         case VIM_ACTION_PAGE_DOWN:
             *code16         = KC_PAGE_DOWN;
-            next_vline      = VLINE_DOWN;
             pending.keycode = KC_NO;
             break;
         case VIM_ACTION_PASTE:
-            *code16           = command_mods | KC_V;
+            *code16           = host->command_mods | KC_V;
             pending.keycode   = KC_NO;
             selection_cleared = true;
             break;
         case VIM_ACTION_UNDO:
-            *code16         = command_mods | KC_Z;
+            *code16         = host->command_mods | KC_Z;
             pending.keycode = KC_NO;
             break;
         case VIM_ACTION_JOIN_LINE:
-            code16[0]         = line_end;
+            code16[0]         = host->line_end;
             code16[1]         = KC_SPACE;
             code16[2]         = KC_DEL;
             selection_cleared = true;
@@ -181,31 +334,29 @@ void vim_perform_action(vim_action_t action, vim_send_type_t type) {
     }
 
     if (action & (VIM_MOD_DELETE | VIM_MOD_YANK)) {
-        *code16 |= QK_LSFT;
         type = VIM_SEND_TAP;
     }
 
-    if (action & VIM_MOD_SELECT) {
-        *code16 |= QK_LSFT;
+    // nothing to select for the visual selection itself, or for `x` and `p`
+    if ((action & (VIM_MOD_DELETE | VIM_MOD_YANK | VIM_MOD_SELECT)) && *code16 != KC_NO) {
+        // in v-block mode, the host's column selection, or just the motion
+        *code16 |= VIM_IS_VBLOCK(vim_get_mode()) ? host->block_mods : QK_LSFT;
     }
 
-    if (vim_get_mode() == VIM_MODE_VLINE) {
-        // if we start moving up, re-select the first line, which has been
-        // selected with the (now disproven) assumption that we're gonna go down
-        if (vline == VLINE_DOWN_ASSUMED && next_vline != VLINE_DOWN_ASSUMED) {
-            if (next_vline == VLINE_UP) {
-                vim_vline_start(VLINE_UP);
-            }
-            vline = next_vline;
-        }
+    int8_t repeat = (pending.repeat == 0) ? 1 : pending.repeat;
+
+    // the count of `3a` or `3I` repeats the inserted text, not the motion
+    if ((action & VIM_MASK_MODE) == VIM_ENTER_INSERT && !(action & VIM_MOD_DELETE)) {
+        repeat = 1;
     }
 
-    int8_t repeat = (pending.repeat == 0) ? 1 : pending.repeat;
+    // may re-anchor the selection first, and leave fewer lines to go
+    repeat = vim_selection_motion(action, repeat, type);
 
     if ((action & VIM_MASK_ACTION) == VIM_ACTION_LINE) {
         type = VIM_SEND_TAP;
-        vim_send(line_start, type);
-        const uint16_t end_right[] = {LSFT(line_end), LSFT(KC_RIGHT)};
+        vim_send(host->line_start, type);
+        const uint16_t end_right[] = {LSFT(host->line_end), LSFT(KC_RIGHT)};
         vim_send_repeated_multi(repeat, end_right, 2);
         repeat = 1;
     }
@@ -214,28 +365,21 @@ void vim_perform_action(vim_action_t action, vim_send_type_t type) {
         vim_send_repeated_multi(repeat, code16, 3);
     } else if (code16[1] != KC_NO) {
         vim_send_repeated_multi(repeat, code16, 2);
-    } else if (code16[0] != KC_NO) {
+    } else if (code16[0] != KC_NO && repeat > 0) {
         // keycode is KC_NO in visual mode, where the object is the visual
         // selection
         vim_send_repeated(repeat, *code16, type);
     }
 
-    if (vim_get_mode() == VIM_MODE_VLINE) {
-        // select the full line after we release the up/down key, or after a tap
-        if (type & VIM_SEND_RELEASE) {
-            if (vline == VLINE_UP) {
-                vim_send(LSFT(line_start), VIM_SEND_TAP);
-            } else if (vline == VLINE_DOWN) {
-                vim_send(LSFT(line_end), VIM_SEND_TAP);
-            }
-        }
-    }
-
     if (action & VIM_MOD_DELETE) {
-        vim_send(command_mods | KC_X, VIM_SEND_TAP);
+        vim_send(host->command_mods | KC_X, VIM_SEND_TAP);
         selection_cleared = true;
     } else if (action & VIM_MOD_YANK) {
-        vim_send(command_mods | KC_C, VIM_SEND_TAP);
+        vim_send(host->command_mods | KC_C, VIM_SEND_TAP);
+        if ((action & VIM_MASK_ACTION) == VIM_ACTION_SELECTION) {
+            vim_selection_yanked();
+            selection_cleared = true;
+        }
     }
 
     // Selecting the whole line leaves us on the beginning of the next one.
@@ -246,6 +390,6 @@ void vim_perform_action(vim_action_t action, vim_send_type_t type) {
         selection_cleared = true;
     }
 
-    VIM_DPRINTF("vim_perform_action %x\n", action);
+    VIM_LOG(ACTION, action);
     vim_enter_mode(VIM_MODE_FROM_ACTION(action), selection_cleared);
 }
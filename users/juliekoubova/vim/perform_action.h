@@ -16,9 +16,11 @@
 
 #pragma once
 #include "vim_mode.h"
+#include "pending.h"
 #include "statemachine.h"
 #include "vim_send.h"
 
 void vim_perform_action(vim_action_t, vim_send_type_t);
-void vim_vline_entered(void);
-void vim_vline_task(void);
+void vim_perform_argument(uint16_t keycode);
+void vim_perform_object(uint16_t keycode, vim_action_t object, vim_pending_t pending);
+void vim_perform_pending_action(vim_action_t, vim_send_type_t, vim_pending_t);
@@ -0,0 +1,146 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profile.h"
+
+#ifdef VIM_PROFILE
+#    include "debug.h"
+#    include "quantum/quantum.h"
+#    include <string.h>
+
+#    if defined(MCU_STM32)
+#        include <ch.h>
+#        include <hal.h>
+#        define VIM_PROFILE_TICKS_PER_US (STM32_SYSCLK / 1000000)
+#    elif defined(MCU_RP)
+#        include "hardware/timer.h"
+#        define VIM_PROFILE_TICKS_PER_US 1
+#    else
+#        error "VIM_PROFILE needs the DWT cycle counter of an STM32, or the RP2040 microsecond timer"
+#    endif
+
+// the last bucket also counts everything slower than 1 << (BUCKETS - 2) us
+#    ifndef VIM_PROFILE_BUCKETS
+#        define VIM_PROFILE_BUCKETS 16
+#    endif
+
+#    ifndef VIM_PROFILE_STALL_US
+#        define VIM_PROFILE_STALL_US 1000
+#    endif
+
+typedef struct {
+    uint16_t buckets[VIM_PROFILE_BUCKETS];
+    uint32_t max_us;
+    uint16_t stalls;
+} vim_histogram_t;
+
+static vim_histogram_t vim_histograms[VIM_PROBE_COUNT];
+
+static const char *const vim_probe_names[VIM_PROBE_COUNT] = {
+    [VIM_PROBE_PROCESS_RECORD] = "process_record",
+    [VIM_PROBE_LOOKUP]         = "lookup",
+    [VIM_PROBE_PERFORM_ACTION] = "perform_action",
+    [VIM_PROBE_SEND]           = "send",
+    [VIM_PROBE_SCAN]           = "scan",
+    [VIM_PROBE_EMIT]           = "emit",
+};
+
+// how many probes are running right now
+static uint8_t vim_profile_depth = 0;
+
+void vim_profile_init(void) {
+#    if defined(MCU_STM32)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#    endif
+}
+
+static uint32_t vim_profile_now(void) {
+#    if defined(MCU_STM32)
+    return DWT->CYCCNT;
+#    else
+    return time_us_32();
+#    endif
+}
+
+static void vim_profile_record(vim_probe_t probe, uint32_t start, bool outermost) {
+    uint32_t         us        = (vim_profile_now() - start) / VIM_PROFILE_TICKS_PER_US;
+    vim_histogram_t *histogram = &vim_histograms[probe];
+
+    // bucket n counts durations of [2^(n-1), 2^n) microseconds
+    uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+    if (bucket >= VIM_PROFILE_BUCKETS) {
+        bucket = VIM_PROFILE_BUCKETS - 1;
+    }
+    if (histogram->buckets[bucket] < UINT16_MAX) {
+        histogram->buckets[bucket]++;
+    }
+    if (us > histogram->max_us) {
+        histogram->max_us = us;
+    }
+    if (us >= VIM_PROFILE_STALL_US) {
+        if (histogram->stalls < UINT16_MAX) {
+            histogram->stalls++;
+        }
+        // printing the log slows the scan loop down, so don't feed that back
+        if (outermost && probe != VIM_PROBE_SCAN) {
+            VIM_LOG(PROFILE_STALL, probe, us > UINT16_MAX ? UINT16_MAX : us);
+        }
+    }
+}
+
+uint32_t vim_profile_begin(void) {
+    vim_profile_depth++;
+    return vim_profile_now();
+}
+
+void vim_profile_end(vim_probe_t probe, uint32_t start) {
+    vim_profile_depth--;
+    vim_profile_record(probe, start, vim_profile_depth == 0);
+}
+
+// Call this once every scan loop, the time between calls is how long the
+// keyboard wasn't scanning the matrix, e.g. while Vim mode was sending keys.
+void vim_profile_scan(void) {
+    static uint32_t last = 0;
+    uint32_t        now  = vim_profile_now();
+    if (last) {
+        vim_profile_record(VIM_PROBE_SCAN, last, false);
+    }
+    last = now;
+}
+
+void vim_profile_dump(void) {
+    for (uint8_t probe = 0; probe < VIM_PROBE_COUNT; probe++) {
+        vim_histogram_t *histogram = &vim_histograms[probe];
+        xprintf("vim profile %s: max=%luus stalls=%u\n", vim_probe_names[probe],
+                (unsigned long)histogram->max_us, histogram->stalls);
+        for (uint8_t bucket = 0; bucket < VIM_PROFILE_BUCKETS; bucket++) {
+            if (!histogram->buckets[bucket]) {
+                continue;
+            }
+            if (bucket == VIM_PROFILE_BUCKETS - 1) {
+                xprintf("  >=%luus: %u\n", 1UL << (bucket - 1), histogram->buckets[bucket]);
+            } else {
+                xprintf("  <%luus: %u\n", 1UL << bucket, histogram->buckets[bucket]);
+            }
+        }
+    }
+    memset(vim_histograms, 0, sizeof(vim_histograms));
+}
+
+#endif
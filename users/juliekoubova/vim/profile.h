@@ -0,0 +1,59 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// With VIM_PROFILE, the time spent in the hot path is collected into log2
+// histograms, and events that block the scan loop for longer than
+// VIM_PROFILE_STALL_US are logged. Without it, all of this compiles out.
+#ifndef VIM_PROFILE_COMMAND_KEY
+#    define VIM_PROFILE_COMMAND_KEY KC_P
+#endif
+
+typedef enum {
+    VIM_PROBE_PROCESS_RECORD,
+    VIM_PROBE_LOOKUP,
+    VIM_PROBE_PERFORM_ACTION,
+    VIM_PROBE_SEND,
+    VIM_PROBE_SCAN,
+    VIM_PROBE_EMIT,
+    VIM_PROBE_COUNT,
+} vim_probe_t;
+
+#ifdef VIM_PROFILE
+
+uint32_t vim_profile_begin(void);
+void     vim_profile_end(vim_probe_t probe, uint32_t start);
+void     vim_profile_init(void);
+void     vim_profile_dump(void);
+void     vim_profile_scan(void);
+
+// Probes nest, e.g. a send within an action within a key. A stall is counted in
+// every probe it happened in, but only logged once, by the outermost one.
+#    define VIM_PROFILE_BEGIN(name) uint32_t vim_profile_##name = vim_profile_begin()
+#    define VIM_PROFILE_END(name, probe) vim_profile_end(probe, vim_profile_##name)
+
+#else
+
+#    define VIM_PROFILE_BEGIN(name) ((void)0)
+#    define VIM_PROFILE_END(name, probe) ((void)0)
+
+static inline void vim_profile_init(void) {}
+static inline void vim_profile_scan(void) {}
+
+#endif
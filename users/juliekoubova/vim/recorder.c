@@ -0,0 +1,138 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "recorder.h"
+#include "host.h"
+#include "vim_mode.h"
+
+#ifdef VIM_RECORDER
+
+#    ifndef VIM_RECORDER_SIZE
+#        define VIM_RECORDER_SIZE 256
+#    endif
+
+#    ifndef VIM_RECORDER_RAW_HID_ID
+#        define VIM_RECORDER_RAW_HID_ID 0x77
+#    endif
+
+#    define VIM_RECORDER_MAGIC 0x5256
+#    define VIM_RECORDER_MAX_DELTA 0xfff
+
+_Static_assert((VIM_RECORDER_SIZE & (VIM_RECORDER_SIZE - 1)) == 0,
+               "VIM_RECORDER_SIZE must be a power of two");
+_Static_assert(VIM_RECORD_COUNT <= 16, "the event type has four bits");
+
+typedef struct {
+    uint16_t header; // type and time
+    uint16_t value;
+} vim_record_t;
+
+// The dump format is this header, little-endian, followed by the events from
+// the oldest to the newest. The host and mode are the ones at the time of the
+// dump, the mode of the oldest event is whatever the next MODE event left.
+typedef struct {
+    uint16_t magic;
+    uint16_t count;
+    uint8_t  host;
+    uint8_t  mode;
+    uint16_t dropped; // overwritten events, saturated
+} vim_recorder_header_t;
+
+static vim_record_t vim_recorder_events[VIM_RECORDER_SIZE];
+static uint16_t     vim_recorder_head    = 0;
+static uint16_t     vim_recorder_count   = 0;
+static uint16_t     vim_recorder_dropped = 0;
+static uint32_t     vim_recorder_time    = 0;
+
+void vim_record(vim_record_type_t type, uint16_t value) {
+    uint32_t now      = timer_read32();
+    uint32_t delta    = vim_recorder_count ? now - vim_recorder_time : 0;
+    vim_recorder_time = now;
+
+    vim_record_t *event = &vim_recorder_events[vim_recorder_head++ % VIM_RECORDER_SIZE];
+    event->header       = type << 12 | (delta > VIM_RECORDER_MAX_DELTA ? VIM_RECORDER_MAX_DELTA : delta);
+    event->value        = value;
+    if (vim_recorder_count < VIM_RECORDER_SIZE) {
+        vim_recorder_count++;
+    } else if (vim_recorder_dropped < UINT16_MAX) {
+        vim_recorder_dropped++;
+    }
+}
+
+// Forgets every event, e.g. once a dump was read
+void vim_recorder_clear(void) {
+    vim_recorder_count   = 0;
+    vim_recorder_dropped = 0;
+}
+
+// The byte at the offset of the dump, so that it can be read in any chunks
+// without a copy of the ring
+static uint8_t vim_recorder_byte(uint16_t offset, const vim_recorder_header_t *header) {
+    if (offset < sizeof(*header)) {
+        return ((const uint8_t *)header)[offset];
+    }
+    offset -= sizeof(*header);
+    uint16_t index = (vim_recorder_head - vim_recorder_count + offset / sizeof(vim_record_t)) %
+                     VIM_RECORDER_SIZE;
+    return ((const uint8_t *)&vim_recorder_events[index])[offset % sizeof(vim_record_t)];
+}
+
+static uint16_t vim_recorder_size(vim_recorder_header_t *header) {
+    header->magic   = VIM_RECORDER_MAGIC;
+    header->count   = vim_recorder_count;
+    header->host    = vim_get_host();
+    header->mode    = vim_get_mode();
+    header->dropped = vim_recorder_dropped;
+    return sizeof(*header) + vim_recorder_count * sizeof(vim_record_t);
+}
+
+// Prints the events as `vimrec:` lines, see tools/vim_recorder_decode.py
+void vim_recorder_dump(void) {
+    static const char     hex[] = "0123456789abcdef";
+    vim_recorder_header_t header;
+    uint16_t              size = vim_recorder_size(&header);
+    char                  line[33];
+    for (uint16_t offset = 0; offset < size; offset += 16) {
+        uint8_t length = 0;
+        for (uint16_t i = offset; i < offset + 16 && i < size; i++) {
+            uint8_t byte   = vim_recorder_byte(i, &header);
+            line[length++] = hex[byte >> 4];
+            line[length++] = hex[byte & 0xf];
+        }
+        line[length] = 0;
+        xprintf("vimrec:%s\n", line);
+    }
+    xprintf("vimrec:end\n");
+}
+
+// Call this from raw_hid_receive. A report starting with VIM_RECORDER_RAW_HID_ID
+// and a little-endian offset gets back the dump from that offset on, after the
+// same three bytes. Events recorded between two reports shift the dump, so
+// read it while the keyboard is idle.
+bool vim_recorder_raw_hid(uint8_t *data, uint8_t length) {
+    if (length < 4 || data[0] != VIM_RECORDER_RAW_HID_ID) {
+        return false;
+    }
+    vim_recorder_header_t header;
+    uint16_t              size   = vim_recorder_size(&header);
+    uint16_t              offset = data[1] | (data[2] << 8);
+    for (uint8_t i = 3; i < length; i++, offset++) {
+        data[i] = offset < size ? vim_recorder_byte(offset, &header) : 0;
+    }
+    return true;
+}
+
+#endif
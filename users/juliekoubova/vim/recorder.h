@@ -0,0 +1,66 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "quantum/quantum.h"
+
+// With VIM_RECORDER, the last VIM_RECORDER_SIZE events are kept in a ring in
+// RAM: every key coming into process_record_vim, every mode change, and every
+// key, mod and wheel report Vim mode sends. Each event takes four bytes, the
+// oldest ones are overwritten, and recording never waits for anything.
+#ifndef VIM_RECORDER_COMMAND_KEY
+#    define VIM_RECORDER_COMMAND_KEY KC_R
+#endif
+
+// the top four bits of an event, the other twelve are the milliseconds since
+// the previous one
+typedef enum {
+    VIM_RECORD_KEY_UP,
+    VIM_RECORD_KEY_DOWN,
+    VIM_RECORD_TAP_UP, // mod-tap and layer-tap keys with a tap count
+    VIM_RECORD_TAP_DOWN,
+    VIM_RECORD_MODE,
+    VIM_RECORD_HOST,
+    VIM_RECORD_SEND_DOWN, // a keycode, with its mods
+    VIM_RECORD_SEND_UP,
+    VIM_RECORD_SEND_CLEAR, // all keys up, these mods held
+    VIM_RECORD_SEND_WHEEL,
+    VIM_RECORD_COUNT,
+} vim_record_type_t;
+
+#ifdef VIM_RECORDER
+
+void vim_record(vim_record_type_t type, uint16_t value);
+void vim_recorder_dump(void);
+void vim_recorder_clear(void);
+bool vim_recorder_raw_hid(uint8_t *data, uint8_t length);
+
+static inline void vim_record_key(uint16_t keycode, const keyrecord_t *record) {
+    vim_record((record->tap.count ? VIM_RECORD_TAP_UP : VIM_RECORD_KEY_UP) + record->event.pressed,
+               keycode);
+}
+
+#else
+
+static inline void vim_record(vim_record_type_t type, uint16_t value) {}
+static inline void vim_record_key(uint16_t keycode, const keyrecord_t *record) {}
+static inline bool vim_recorder_raw_hid(uint8_t *data, uint8_t length) {
+    return false;
+}
+
+#endif
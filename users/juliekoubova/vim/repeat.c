@@ -0,0 +1,209 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "repeat.h"
+#include "debug.h"
+#include "fast_path.h"
+#include "minimal.h"
+#include "perform_action.h"
+#include "vim_mode.h"
+#include "vim_send.h"
+
+#ifndef VIM_REPEAT_BUFFER_SIZE
+#    define VIM_REPEAT_BUFFER_SIZE 32
+#endif
+
+typedef struct {
+    vim_action_t  action;
+    vim_pending_t pending;
+    // the `w` of `ciw`, the action is then the text object
+    uint8_t       object;
+    bool          valid : 1;
+    bool          recording : 1;
+    // the inserted text didn't fit into the buffer, `.` will only replay the
+    // command itself and leave you in insert mode to type the text again
+    bool     overflow : 1;
+    uint8_t  length;
+    uint16_t keys[VIM_REPEAT_BUFFER_SIZE];
+} vim_repeat_t;
+
+static vim_repeat_t vim_repeat = {0};
+static bool         vim_replaying = false;
+
+static bool vim_is_change(vim_action_t action, vim_pending_t pending) {
+    switch (action & VIM_MASK_ACTION) {
+        case VIM_ACTION_PAGE_UP:
+        case VIM_ACTION_PAGE_DOWN:
+        case VIM_ACTION_SCROLL_DOWN:
+        case VIM_ACTION_SCROLL_UP:
+        case VIM_ACTION_HALF_PAGE_DOWN:
+        case VIM_ACTION_HALF_PAGE_UP:
+        case VIM_ACTION_SEARCH:
+        case VIM_ACTION_SEARCH_BACKWARD:
+        case VIM_ACTION_SEARCH_NEXT:
+        case VIM_ACTION_SEARCH_PREVIOUS:
+        case VIM_ACTION_SEARCH_WORD:
+        case VIM_ACTION_SEARCH_WORD_BACKWARD:
+        case VIM_ACTION_REPEAT:
+        case VIM_ACTION_SELECTION:
+        case VIM_ACTION_UNDO:
+            return false;
+        case VIM_ACTION_JOIN_LINE:
+        case VIM_ACTION_OPEN_LINE_DOWN:
+        case VIM_ACTION_OPEN_LINE_UP:
+        case VIM_ACTION_PASTE:
+            return true;
+        default:
+            return (action & VIM_MOD_DELETE) || (action & VIM_MASK_MODE) == VIM_ENTER_INSERT ||
+                   pending.keycode == KC_C || pending.keycode == KC_D;
+    }
+}
+
+static bool vim_enters_insert(vim_action_t action, vim_pending_t pending) {
+    return (action & VIM_MASK_MODE) == VIM_ENTER_INSERT || pending.keycode == KC_C;
+}
+
+// With `3ihello`, the count applies to the inserted text rather than to the
+// motion. That's the case for every command entering insert mode, except for
+// the ones deleting something first (`3s`, `3cw`).
+static uint8_t vim_insert_count(vim_action_t action, vim_pending_t pending) {
+    if (action & VIM_MOD_DELETE || pending.keycode == KC_C || pending.repeat == 0) {
+        return 1;
+    }
+    return pending.repeat;
+}
+
+// Repeated `o` and `O` put each copy of the text on its own line.
+static uint16_t vim_insert_separator(vim_action_t action) {
+    switch (action & VIM_MASK_ACTION) {
+        case VIM_ACTION_OPEN_LINE_DOWN:
+        case VIM_ACTION_OPEN_LINE_UP:
+            return KC_ENTER;
+        default:
+            return KC_NO;
+    }
+}
+
+static void vim_repeat_send_insert(uint8_t count) {
+    uint16_t separator = vim_insert_separator(vim_repeat.action);
+    for (uint8_t i = 0; i < count; i++) {
+        if (i > 0 && separator != KC_NO) {
+            vim_send(separator, VIM_SEND_TAP);
+        }
+        vim_send_multi(vim_repeat.keys, vim_repeat.length);
+    }
+}
+
+static bool vim_repeat_start(vim_action_t action, vim_pending_t pending) {
+    if (vim_replaying || vim_get_mode() != VIM_MODE_COMMAND || !vim_is_change(action, pending)) {
+        return false;
+    }
+    VIM_LOG(REPEAT_RECORD, action, pending.keycode, pending.repeat);
+    vim_repeat.action    = action;
+    vim_repeat.pending   = pending;
+    vim_repeat.object    = KC_NO;
+    vim_repeat.valid     = true;
+    vim_repeat.recording = vim_enters_insert(action, pending);
+    vim_set_slow_path(VIM_SLOW_PATH_REPEAT, vim_repeat.recording);
+    vim_repeat.overflow  = false;
+    vim_repeat.length    = 0;
+    return true;
+}
+
+void vim_repeat_record(vim_action_t action, vim_pending_t pending) {
+    vim_repeat_start(action, pending);
+}
+
+// `ciw` and `dap` are recorded with the text object as the action
+void vim_repeat_record_object(uint8_t keycode, vim_action_t object, vim_pending_t pending) {
+    if (vim_repeat_start(object, pending)) {
+        vim_repeat.object = keycode;
+    }
+}
+
+void vim_repeat_insert_key(uint16_t keycode, const keyrecord_t *record) {
+    if (!vim_repeat.recording || !record->event.pressed) {
+        return;
+    }
+    if (!IS_QK_BASIC(keycode) && !IS_QK_MODS(keycode)) {
+        // layer keys, one-shot mods and such don't type anything by themselves
+        return;
+    }
+    if (IS_MODIFIER_KEYCODE(keycode)) {
+        // captured along with the key they modify
+        return;
+    }
+    if (vim_repeat.length == VIM_REPEAT_BUFFER_SIZE) {
+        if (!vim_repeat.overflow) {
+            VIM_LOG(REPEAT_OVERFLOW);
+        }
+        vim_repeat.overflow = true;
+        return;
+    }
+
+    // fold right-hand mods onto the left ones, vim_send only does left mods.
+    // the mods of a tap still being sent, e.g. the Ctrl+X of `cw`, aren't
+    // the user's.
+    uint8_t mods = (get_mods() & ~vim_send_get_mods()) | get_oneshot_mods() | get_weak_mods();
+    mods         = (mods | (mods >> 4)) & 0x0f;
+    vim_repeat.keys[vim_repeat.length++] = keycode | (mods << 8);
+}
+
+void vim_repeat_insert_finished(void) {
+    if (!vim_repeat.recording) {
+        return;
+    }
+    vim_repeat.recording = false;
+    vim_set_slow_path(VIM_SLOW_PATH_REPEAT, false);
+
+    uint8_t count = vim_insert_count(vim_repeat.action, vim_repeat.pending);
+    VIM_LOG(REPEAT_RECORDED, vim_repeat.length, count - 1);
+    if (count > 1 && !vim_repeat.overflow) {
+        vim_repeat_send_insert(count - 1);
+    }
+}
+
+// `.` does nothing until the next change, and a count before an insert that
+// is still going on is dropped
+void vim_repeat_forget(void) {
+    vim_repeat = (vim_repeat_t){0};
+    vim_set_slow_path(VIM_SLOW_PATH_REPEAT, false);
+}
+
+void vim_repeat_replay(uint8_t repeat) {
+    if (!vim_repeat.valid) {
+        VIM_LOG(REPEAT_NOTHING);
+        return;
+    }
+
+    vim_pending_t pending = vim_repeat.pending;
+    if (repeat > 0) {
+        pending.repeat = repeat;
+    }
+
+    VIM_LOG(REPEAT_REPLAY, vim_repeat.action, pending.repeat);
+    vim_replaying = true;
+    if (vim_repeat.object != KC_NO) {
+        vim_perform_object(vim_repeat.object, vim_repeat.action, pending);
+    } else {
+        vim_perform_pending_action(vim_repeat.action, VIM_SEND_TAP, pending);
+    }
+    if (vim_get_mode() == VIM_MODE_INSERT && !vim_repeat.overflow) {
+        vim_repeat_send_insert(vim_insert_count(vim_repeat.action, pending));
+        vim_enter_command_mode(false);
+    }
+    vim_replaying = false;
+}
@@ -0,0 +1,31 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "quantum/quantum.h"
+#include "pending.h"
+#include "statemachine.h"
+
+// Remembers the last change command performed in command mode, together with
+// the keys typed in insert mode afterwards, so that `.` can replay it.
+void vim_repeat_record(vim_action_t action, vim_pending_t pending);
+void vim_repeat_record_object(uint8_t keycode, vim_action_t object, vim_pending_t pending);
+void vim_repeat_insert_key(uint16_t keycode, const keyrecord_t *record);
+void vim_repeat_insert_finished(void);
+void vim_repeat_replay(uint8_t repeat);
+void vim_repeat_forget(void);
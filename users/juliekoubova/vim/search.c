@@ -0,0 +1,85 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "search.h"
+#include "debug.h"
+#include "host.h"
+#include "vim_mode.h"
+#include "vim_send.h"
+
+static bool vim_search_backward = false;
+
+void vim_search_start(bool backward) {
+    VIM_LOG(SEARCH, backward);
+    vim_search_backward = backward;
+    vim_send(vim_host_profile()->find, VIM_SEND_TAP);
+    vim_enter_search_mode();
+}
+
+void vim_search_word(bool backward, int8_t repeat) {
+    const vim_host_profile_t *host          = vim_host_profile();
+    uint16_t                  backward_word = host->word_mods | KC_LEFT;
+    uint16_t                  forward_word  = host->word_mods | KC_RIGHT;
+    VIM_LOG(SEARCH_WORD, backward, repeat);
+    vim_search_backward = backward;
+
+    // selected the same way as `viw`
+    vim_send(forward_word, VIM_SEND_TAP);
+    vim_send(backward_word, VIM_SEND_TAP);
+    vim_send(forward_word | QK_LSFT, VIM_SEND_TAP);
+    if (host->ends_at_next_start) {
+        vim_send(LSFT(KC_LEFT), VIM_SEND_TAP);
+    }
+
+    vim_send(host->find_selection, VIM_SEND_TAP);
+    vim_search_next(false, repeat);
+    if (host->find_selection == host->find) {
+        // Ctrl+F opened the find box with the word in it, Cmd+E opens nothing
+        vim_send(KC_ESCAPE, VIM_SEND_TAP);
+    }
+}
+
+void vim_search_next(bool reverse, int8_t repeat) {
+    const vim_host_profile_t *host = vim_host_profile();
+    VIM_LOG(SEARCH_NEXT, reverse, repeat);
+    bool backward = vim_search_backward != reverse;
+    vim_send_repeated(repeat, backward ? host->find_previous : host->find_next, VIM_SEND_TAP);
+}
+
+bool vim_search_process(uint16_t keycode, const keyrecord_t *record) {
+    if (!record->event.pressed) {
+        return false;
+    }
+    switch (keycode) {
+        case KC_ENTER:
+            // Enter jumps to the first match, the host's Esc closes the find
+            // box and leaves the match selected
+            vim_enter_command_mode(true);
+            vim_send(vim_search_backward ? LSFT(KC_ENTER) : KC_ENTER, VIM_SEND_TAP);
+            vim_send(KC_ESCAPE, VIM_SEND_TAP);
+            return true;
+        case KC_ESCAPE:
+            vim_search_cancel();
+            return true;
+        default:
+            return false;
+    }
+}
+
+void vim_search_cancel(void) {
+    vim_enter_command_mode(true);
+    vim_send(KC_ESCAPE, VIM_SEND_TAP);
+}
@@ -0,0 +1,33 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "quantum/quantum.h"
+
+// `/` and `?` open the host's find, `*` and `#` search for the word under the
+// cursor
+void vim_search_start(bool backward);
+void vim_search_word(bool backward, int8_t repeat);
+// `n` and `N`, in the direction of the last search
+void vim_search_next(bool reverse, int8_t repeat);
+
+// Returns true for Enter and Esc, which leave search mode. Everything else is
+// typed into the find box.
+bool vim_search_process(uint16_t keycode, const keyrecord_t *record);
+// Closes the find box when search mode is left with the vim key
+void vim_search_cancel(void);
@@ -0,0 +1,479 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "selection.h"
+#include "debug.h"
+#include "host.h"
+#include "quantum/quantum.h"
+#include "sram.h"
+#include "timer_wheel.h"
+#include <stdlib.h>
+
+// `o` and `gv` don't replay more arrow keys than this, past that the other
+// end of the selection is considered lost.
+#ifndef VIM_SELECTION_MAX_REPLAY
+#    define VIM_SELECTION_MAX_REPLAY 64
+#endif
+
+// A motion held for longer than this has been repeated by the host, or by
+// VIM_REPEAT_ACCELERATION, and there's no telling how many times.
+#ifndef VIM_SELECTION_HOLD_TIME
+#    define VIM_SELECTION_HOLD_TIME 200
+#endif
+
+// select the full line after we release the up/down key, or after a tap. it's
+// deferred, so that a burst of j's or k's only fixes the selection up once.
+#ifndef VIM_VLINE_FIXUP_DELAY
+#    define VIM_VLINE_FIXUP_DELAY VIM_TAP_DELAY
+#endif
+
+typedef struct {
+    int16_t lines; // cursor line relative to the anchor's
+    int16_t chars; // net h and l presses, used in visual and v-block mode only
+    int8_t  side;  // cursor before (-1), on (0), or after (1) the anchor
+    bool    exact; // moved by h, j, k and l only, so it can be replayed
+} vim_cursor_t;
+
+// Relative to the anchor of the selection in the visual modes, and to the
+// anchor of the last one in command mode. A visual mode restored after a reset
+// drops its selection to the left, like it always did.
+static vim_cursor_t vim_cursor    = {.side = -1};
+static vim_cursor_t vim_last      = {0};
+static vim_mode_t   vim_last_mode = 0;
+static uint16_t     vim_pressed   = 0;
+static bool         vim_restoring = false;
+
+static int8_t vim_sign(int16_t value) {
+    return value > 0 ? 1 : value < 0 ? -1 : 0;
+}
+
+static int8_t vim_cursor_side(void) {
+    switch (vim_get_mode()) {
+        case VIM_MODE_VISUAL:
+            return vim_cursor.side;
+#ifndef VIM_NO_VLINE
+        case VIM_MODE_VLINE:
+            return vim_cursor.lines < 0 ? -1 : 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+// vim_send_repeated takes a count of up to 127
+static void vim_send_taps(uint16_t taps, uint16_t code16) {
+    while (taps > 0) {
+        int8_t repeat = taps > INT8_MAX ? INT8_MAX : taps;
+        vim_send_repeated(repeat, code16, VIM_SEND_TAP);
+        taps -= repeat;
+    }
+}
+
+static void vim_send_lines(int16_t lines, uint16_t mods) {
+    vim_send_taps(abs(lines), mods | (lines < 0 ? KC_UP : KC_DOWN));
+}
+
+static void vim_send_chars(int16_t chars, uint16_t mods) {
+    vim_send_taps(abs(chars), mods | (chars < 0 ? KC_LEFT : KC_RIGHT));
+}
+
+// Left and Right drop a selection at its start or its end without moving.
+static void vim_collapse(int8_t side) {
+    if (side > 0) {
+        vim_send(KC_RIGHT, VIM_SEND_TAP);
+    } else if (side < 0) {
+        vim_send(KC_LEFT, VIM_SEND_TAP);
+    }
+}
+
+// Returns false for actions that aren't motions.
+static bool vim_cursor_move(vim_action_t action, int8_t repeat, vim_send_type_t type) {
+    int16_t count = (type & VIM_SEND_PRESS) ? repeat : 0;
+    int16_t lines = vim_cursor.lines;
+    if (type == VIM_SEND_PRESS) {
+        vim_pressed = timer_read();
+    } else if (type == VIM_SEND_RELEASE && timer_elapsed(vim_pressed) >= VIM_SELECTION_HOLD_TIME) {
+        vim_cursor.exact = false;
+    }
+
+    switch (action & VIM_MASK_ACTION) {
+        case VIM_ACTION_LEFT:
+            vim_cursor.chars -= count;
+            break;
+        case VIM_ACTION_RIGHT:
+            vim_cursor.chars += count;
+            break;
+        case VIM_ACTION_UP:
+        case VIM_ACTION_DOWN:
+            vim_cursor.lines += (action & VIM_MASK_ACTION) == VIM_ACTION_UP ? -count : count;
+            if (!vim_cursor.exact && (lines < 0) != (vim_cursor.lines < 0)) {
+                // without knowing how far we are, assume we stay on the same side
+                vim_cursor.lines = lines < 0 ? -1 : 0;
+            }
+            break;
+        case VIM_ACTION_WORD_START:
+        case VIM_ACTION_WORD_END:
+            // a word rarely takes the cursor past the anchor
+            vim_cursor.exact = false;
+            if (vim_cursor.side == 0) {
+                vim_cursor.side = (action & VIM_MASK_ACTION) == VIM_ACTION_WORD_END ? 1 : -1;
+            }
+            break;
+        case VIM_ACTION_LINE_START:
+        case VIM_ACTION_LINE_END:
+            vim_cursor.exact = false;
+            if (vim_cursor.lines == 0) {
+                vim_cursor.side = (action & VIM_MASK_ACTION) == VIM_ACTION_LINE_END ? 1 : -1;
+            }
+            break;
+        case VIM_ACTION_DOCUMENT_START:
+        case VIM_ACTION_PAGE_UP:
+            vim_cursor = (vim_cursor_t){.lines = -1, .side = -1};
+            break;
+        case VIM_ACTION_DOCUMENT_END:
+        case VIM_ACTION_PAGE_DOWN:
+            vim_cursor = (vim_cursor_t){.lines = 1, .side = 1};
+            break;
+        default:
+            return false;
+    }
+
+    if (abs(vim_cursor.lines) + abs(vim_cursor.chars) > VIM_SELECTION_MAX_REPLAY) {
+        vim_cursor.exact = false;
+    }
+    if (vim_cursor.exact) {
+        vim_cursor.side = vim_cursor.lines ? vim_sign(vim_cursor.lines) : vim_sign(vim_cursor.chars);
+    }
+    VIM_LOG(SELECTION, vim_cursor.lines, vim_cursor.chars, vim_cursor.exact);
+    return true;
+}
+
+#ifndef VIM_NO_VLINE
+// Goes back to the line of the anchor, and anchors the selection at its start
+// when going down from there, or at its end when going up.
+static void vim_vline_anchor(bool up) {
+    const vim_host_profile_t *host = vim_host_profile();
+    if (vim_cursor.lines != 0) {
+        vim_collapse(vim_cursor_side());
+        vim_send_lines(-vim_cursor.lines, 0);
+    }
+    vim_send(up ? host->line_end : host->line_start, VIM_SEND_TAP);
+    vim_cursor.lines = 0;
+}
+
+static void vim_vline_select(int16_t lines) {
+    const vim_host_profile_t *host = vim_host_profile();
+    vim_vline_anchor(lines < 0);
+    vim_send_lines(lines, QK_LSFT);
+    vim_send(LSFT(lines < 0 ? host->line_start : host->line_end), VIM_SEND_TAP);
+    vim_cursor.lines = lines;
+}
+
+static void vim_vline_fixup(void) {
+    if (vim_get_mode() != VIM_MODE_VLINE) {
+        return;
+    }
+    const vim_host_profile_t *host = vim_host_profile();
+    vim_send(LSFT(vim_cursor.lines < 0 ? host->line_start : host->line_end), VIM_SEND_TAP);
+}
+
+// any other action needs the full line selected right away
+void vim_vline_fixup_now(vim_action_t action) {
+    switch (action & VIM_MASK_ACTION) {
+        case VIM_ACTION_UP:
+        case VIM_ACTION_DOWN:
+            vim_timer_cancel(VIM_TIMER_VLINE);
+            break;
+        default:
+            if (vim_timer_is_scheduled(VIM_TIMER_VLINE)) {
+                vim_timer_cancel(VIM_TIMER_VLINE);
+                vim_vline_fixup();
+            }
+            break;
+    }
+}
+
+// When the cursor crosses the line of the anchor, the line has to be selected
+// from its other end. Returns how many lines are still left to go.
+static int8_t vim_vline_motion(vim_action_t action, int8_t repeat) {
+    int16_t target;
+    switch (action & VIM_MASK_ACTION) {
+        case VIM_ACTION_UP:
+            target = vim_cursor.lines - repeat;
+            break;
+        case VIM_ACTION_DOWN:
+            target = vim_cursor.lines + repeat;
+            break;
+        case VIM_ACTION_DOCUMENT_START:
+            target = -1;
+            break;
+        case VIM_ACTION_DOCUMENT_END:
+            target = 1;
+            break;
+        default:
+            return repeat;
+    }
+    if ((target < 0) == (vim_cursor.lines < 0) || !vim_cursor.exact) {
+        return repeat;
+    }
+    vim_vline_anchor(target < 0);
+    switch (action & VIM_MASK_ACTION) {
+        case VIM_ACTION_UP:
+        case VIM_ACTION_DOWN:
+            return abs(target);
+        default:
+            return repeat;
+    }
+}
+#endif
+
+#ifndef VIM_NO_VBLOCK
+// How an edit of the block is sent, the cheapest one that works for its size
+typedef enum {
+    VIM_BLOCK_EMPTY,    // no columns, so there's nothing to edit
+    VIM_BLOCK_NATIVE,   // the host selected the block itself
+    VIM_BLOCK_LINE,     // a single line, selected like in visual mode
+    VIM_BLOCK_PER_LINE, // the columns of each line are deleted in turn
+    VIM_BLOCK_LOST,     // the size of the block isn't known
+} vim_block_strategy_t;
+
+static vim_block_strategy_t vim_block_strategy(bool yank) {
+    if (vim_host_profile()->block_mods != KC_NO) {
+        // already selected, a single shortcut cuts or copies all of it
+        return vim_cursor.exact && vim_cursor.chars == 0 ? VIM_BLOCK_EMPTY : VIM_BLOCK_NATIVE;
+    }
+    if (!vim_cursor.exact) {
+        return VIM_BLOCK_LOST;
+    }
+    if (vim_cursor.chars == 0) {
+        return VIM_BLOCK_EMPTY;
+    }
+    if (vim_cursor.lines == 0) {
+        return VIM_BLOCK_LINE;
+    }
+    // a copy of each line would replace the one before it on the clipboard
+    return yank ? VIM_BLOCK_LOST : VIM_BLOCK_PER_LINE;
+}
+
+// The host leaves a cursor on every line of a column selection, Esc gets rid
+// of all but one
+static void vim_block_collapse(void) {
+    if (vim_host_profile()->block_mods == KC_NO) {
+        return;
+    }
+    vim_collapse(vim_sign(vim_cursor.chars));
+    if (vim_cursor.lines != 0 || !vim_cursor.exact) {
+        vim_send(KC_ESCAPE, VIM_SEND_TAP);
+    }
+}
+
+// Goes to the top left corner of the block, and deletes as many characters
+// from each line. Lines shorter than the block run into the next one, there's
+// no telling where they end.
+static void vim_block_delete_lines(void) {
+    uint16_t width = abs(vim_cursor.chars);
+    vim_send_lines(vim_cursor.lines > 0 ? -vim_cursor.lines : 0, 0);
+    vim_send_chars(vim_cursor.chars > 0 ? -vim_cursor.chars : 0, 0);
+    for (int16_t line = abs(vim_cursor.lines); line >= 0; line--) {
+        vim_send_taps(width, KC_DELETE);
+        if (line > 0) {
+            vim_send(KC_DOWN, VIM_SEND_TAP);
+        }
+    }
+    vim_send_lines(-abs(vim_cursor.lines), 0);
+}
+
+// `d`, `x`, `c` and `y` in v-block mode. `c` on a native block leaves a cursor
+// on every line, so what's typed goes to all of them, elsewhere just the first.
+void vim_block_perform(vim_action_t action) {
+    const vim_host_profile_t *host     = vim_host_profile();
+    bool                      yank     = !(action & VIM_MOD_DELETE);
+    bool                      insert   = (action & VIM_MASK_MODE) == VIM_ENTER_INSERT;
+    vim_block_strategy_t      strategy = vim_block_strategy(yank);
+    VIM_LOG(BLOCK, vim_cursor.lines, vim_cursor.chars, strategy);
+
+    switch (strategy) {
+        case VIM_BLOCK_NATIVE:
+            vim_send(host->command_mods | (yank ? KC_C : KC_X), VIM_SEND_TAP);
+            if (yank) {
+                vim_collapse(-1);
+            }
+            if (!insert && (vim_cursor.lines != 0 || !vim_cursor.exact)) {
+                vim_send(KC_ESCAPE, VIM_SEND_TAP);
+            }
+            break;
+        case VIM_BLOCK_LINE:
+            vim_send_chars(-vim_cursor.chars, QK_LSFT);
+            vim_send(host->command_mods | (yank ? KC_C : KC_X), VIM_SEND_TAP);
+            if (yank) {
+                vim_collapse(-1);
+            }
+            break;
+        case VIM_BLOCK_PER_LINE:
+            vim_block_delete_lines();
+            break;
+        case VIM_BLOCK_EMPTY:
+            // `Ctrl+V` `2j` `c` types on three lines
+            if (!insert) {
+                vim_block_collapse();
+            }
+            break;
+        case VIM_BLOCK_LOST:
+            VIM_LOG(SELECTION_LOST);
+            vim_block_collapse();
+            break;
+    }
+    vim_selection_forget();
+}
+#endif
+
+int8_t VIM_SRAM_FUNC(vim_selection_motion)(vim_action_t action, int8_t repeat, vim_send_type_t type) {
+    vim_mode_t mode = vim_get_mode();
+    if (mode == VIM_MODE_COMMAND) {
+        // anything but h, j, k and l loses the way back to the last selection
+        if (vim_last_mode != 0 &&
+            ((action & ~VIM_MASK_ACTION) || !vim_cursor_move(action, repeat, type) || !vim_cursor.exact)) {
+            vim_selection_forget();
+        }
+        return repeat;
+    }
+    if ((mode != VIM_MODE_VISUAL && !VIM_IS_VLINE(mode) && !VIM_IS_VBLOCK(mode)) ||
+        !(action & VIM_MOD_SELECT)) {
+        return repeat;
+    }
+#ifndef VIM_NO_VLINE
+    if (mode == VIM_MODE_VLINE) {
+        if (type & VIM_SEND_PRESS) {
+            repeat = vim_vline_motion(action, repeat);
+        }
+        if (type & VIM_SEND_RELEASE) {
+            vim_timer_schedule(VIM_TIMER_VLINE, VIM_VLINE_FIXUP_DELAY, vim_vline_fixup);
+        }
+    }
+#endif
+    vim_cursor_move(action, repeat, type);
+    return repeat;
+}
+
+void vim_selection_entered(vim_mode_t from, vim_mode_t to) {
+    if (vim_restoring) {
+        return;
+    }
+#ifndef VIM_NO_VLINE
+    if (from == VIM_MODE_VISUAL && to == VIM_MODE_VLINE) {
+        if (!vim_cursor.exact) {
+            // start over from the line the cursor is on
+            vim_cursor = (vim_cursor_t){.exact = true};
+        }
+        vim_vline_select(vim_cursor.lines);
+        return;
+    }
+    if (from == VIM_MODE_VLINE && to == VIM_MODE_VISUAL) {
+        // the lines stay selected, but the cursor is at the start or the end
+        vim_cursor.chars = 0;
+        vim_cursor.side  = vim_cursor.lines < 0 ? -1 : 1;
+        vim_cursor.exact = false;
+        return;
+    }
+#endif
+    vim_selection_forget();
+    vim_cursor = (vim_cursor_t){.exact = true};
+#ifndef VIM_NO_VLINE
+    if (to == VIM_MODE_VLINE) {
+        vim_vline_select(0);
+    }
+#endif
+}
+
+// Drops the selection where the cursor is, or doesn't send anything at all if
+// nothing is selected, and remembers it for `gv`.
+void vim_selection_clear(void) {
+#ifndef VIM_NO_VBLOCK
+    if (vim_get_mode() == VIM_MODE_VBLOCK) {
+        vim_block_collapse();
+    } else
+#endif
+    {
+        vim_collapse(vim_cursor_side());
+    }
+    vim_last      = vim_cursor;
+    vim_last_mode = vim_get_mode();
+}
+
+// Like Vim, leaves the cursor at the start of what was yanked.
+void vim_selection_yanked(void) {
+    int8_t side = vim_cursor_side();
+    if (side != 0) {
+        vim_send(KC_LEFT, VIM_SEND_TAP);
+    }
+    vim_last      = vim_cursor;
+    vim_last_mode = vim_get_mode();
+    if (side > 0) {
+        vim_cursor.lines = 0;
+        vim_cursor.chars = 0;
+    }
+}
+
+void vim_selection_forget(void) {
+    vim_last_mode = 0;
+}
+
+// `o` collapses the selection at the cursor, and selects back to the anchor.
+void vim_selection_swap(void) {
+    bool   vline = VIM_IS_VLINE(vim_get_mode());
+    int8_t side  = vim_cursor_side();
+    if (!vim_cursor.exact || (vline ? vim_cursor.lines == 0 : side == 0)) {
+        VIM_LOG(SELECTION_LOST);
+        return;
+    }
+    vim_collapse(side);
+    if (vline) {
+        const vim_host_profile_t *host = vim_host_profile();
+        vim_send_lines(-vim_cursor.lines, QK_LSFT);
+        vim_send(LSFT(vim_cursor.lines > 0 ? host->line_start : host->line_end), VIM_SEND_TAP);
+    } else {
+        vim_send_chars(-vim_cursor.chars, QK_LSFT);
+        vim_send_lines(-vim_cursor.lines, QK_LSFT);
+    }
+    vim_cursor.lines = -vim_cursor.lines;
+    vim_cursor.chars = -vim_cursor.chars;
+    vim_cursor.side  = -vim_cursor.side;
+}
+
+// `gv` goes back to the anchor of the last selection and selects it again.
+void vim_selection_reselect(void) {
+    if (vim_last_mode == 0 || !vim_last.exact || !vim_cursor.exact) {
+        VIM_LOG(SELECTION_LOST);
+        return;
+    }
+#ifndef VIM_NO_VLINE
+    if (vim_last_mode == VIM_MODE_VLINE) {
+        vim_vline_select(vim_last.lines);
+    } else
+#endif
+    {
+        // a block is selected with the host's column selection, if it has one
+        uint16_t mods = VIM_IS_VBLOCK(vim_last_mode) ? vim_host_profile()->block_mods : QK_LSFT;
+        vim_send_chars(-vim_cursor.chars, 0);
+        vim_send_lines(-vim_cursor.lines, 0);
+        vim_send_lines(vim_last.lines, mods);
+        vim_send_chars(vim_last.chars, mods);
+    }
+    vim_cursor    = vim_last;
+    vim_restoring = true;
+    vim_enter_mode(vim_last_mode, false);
+    vim_restoring = false;
+}
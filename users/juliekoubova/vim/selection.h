@@ -0,0 +1,42 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "statemachine.h"
+#include "vim_mode.h"
+#include "vim_send.h"
+
+// The host only knows about a selection while shift is held, so the firmware
+// keeps its own idea of where the cursor is relative to the anchor, from the
+// motions it has sent: in lines, and in h and l presses in visual mode. That
+// is enough to re-anchor a v-line selection when the cursor crosses the
+// starting line, to swap the ends (`o`), to reselect (`gv`), to drop a
+// selection where the cursor is, and to edit a block one line at a time.
+
+// Called before the motion is sent, returns how many times to send it.
+int8_t vim_selection_motion(vim_action_t action, int8_t repeat, vim_send_type_t type);
+void   vim_selection_entered(vim_mode_t from, vim_mode_t to);
+void   vim_selection_clear(void);
+void   vim_selection_yanked(void);
+void   vim_selection_forget(void);
+void   vim_selection_swap(void);
+void   vim_selection_reselect(void);
+#ifndef VIM_NO_VLINE
+void vim_vline_fixup_now(vim_action_t action);
+#endif
+#ifndef VIM_NO_VBLOCK
+void vim_block_perform(vim_action_t action);
+#endif
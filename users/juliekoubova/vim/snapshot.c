@@ -0,0 +1,89 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot.h"
+#include "debug.h"
+#include "host.h"
+#include "pending.h"
+#include "quantum/quantum.h"
+#include "vim_mode.h"
+
+#if defined(PROTOCOL_CHIBIOS)
+// ChibiOS leaves everything in .ram0 after __ram0_noinit__ alone at startup
+#    define VIM_NOINIT __attribute__((section(".ram0.vim_snapshot")))
+#elif defined(__AVR__)
+#    define VIM_NOINIT __attribute__((section(".noinit")))
+#endif
+
+#ifdef VIM_NOINIT
+
+#    define VIM_SNAPSHOT_MAGIC 0x56494d31 // "VIM1"
+
+typedef struct {
+    uint32_t      magic;
+    vim_pending_t pending;
+    uint8_t       host;
+    uint8_t       mode;
+    uint8_t       checksum;
+} vim_snapshot_t;
+
+static vim_snapshot_t vim_snapshot VIM_NOINIT;
+
+static uint8_t vim_snapshot_checksum(void) {
+    const uint8_t *bytes    = (const uint8_t *)&vim_snapshot;
+    uint8_t        checksum = 0xa5;
+    for (uint8_t i = 0; i < offsetof(vim_snapshot_t, checksum); i++) {
+        checksum = (checksum << 1 | checksum >> 7) ^ bytes[i];
+    }
+    return checksum;
+}
+
+void vim_snapshot_save(void) {
+    vim_snapshot.magic    = VIM_SNAPSHOT_MAGIC;
+    vim_snapshot.pending  = vim_get_pending();
+    vim_snapshot.host     = vim_get_host();
+    vim_snapshot.mode     = vim_get_mode();
+    vim_snapshot.checksum = vim_snapshot_checksum();
+}
+
+bool vim_snapshot_restore(void) {
+    bool valid = vim_snapshot.magic == VIM_SNAPSHOT_MAGIC &&
+                 vim_snapshot.checksum == vim_snapshot_checksum();
+    // only ever restore a snapshot once
+    vim_snapshot.magic = 0;
+    if (!valid) {
+        VIM_LOG(SNAPSHOT_NONE);
+        return false;
+    }
+
+    VIM_LOG(SNAPSHOT_RESTORE, vim_snapshot.host, vim_snapshot.mode, timer_read());
+    vim_set_host(vim_snapshot.host);
+    // held keys are reported again by the first matrix scan, so mods aren't
+    // part of the snapshot. neither is ex mode, as the command line is gone.
+    vim_restore_mode(vim_snapshot.mode == VIM_MODE_EX ? VIM_MODE_COMMAND : vim_snapshot.mode);
+    vim_restore_pending(vim_snapshot.pending);
+    return true;
+}
+
+#else
+
+void vim_snapshot_save(void) {}
+
+bool vim_snapshot_restore(void) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,34 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// With VIM_SRAM on an RP2040, the functions every command key goes through
+// run from SRAM instead of flash, and the tables they read are copied into
+// SRAM at startup. The first key after a long stretch of typing then doesn't
+// wait for the XIP cache to be refilled from flash.
+#if defined(VIM_SRAM)
+#    if !defined(MCU_RP)
+#        error "VIM_SRAM is only useful on an RP2040"
+#    endif
+// same as __not_in_flash_func of the Pico SDK
+#    define VIM_SRAM_FUNC(name) __attribute__((section(".time_critical." #name), noinline)) name
+// mutable data is copied to SRAM at startup, constant data stays in flash
+#    define VIM_SRAM_CONST
+#else
+#    define VIM_SRAM_FUNC(name) name
+#    define VIM_SRAM_CONST const
+#endif
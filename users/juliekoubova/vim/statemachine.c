@@ -15,47 +15,45 @@
  */
 
 #include "debug.h"
+#include "host.h"
+#include "pending.h"
+#include "quantum/quantum.h"
+#include "sram.h"
 #include "statemachine.h"
 #include "vim_mode.h"
+#include <string.h>
 
 #define VSM_FIRST KC_A
-#define VSM_LAST KC_ESC
+#define VSM_LAST KC_SLASH
 #define VSM_SIZE (VSM_LAST - VSM_FIRST + 1)
 #define VSM_INDEX(key) ((key) >= VSM_FIRST && (key) <= VSM_LAST ? (key - VSM_FIRST) : -1)
 
-#ifdef VIM_DEBUG
-#    define VSM_DEBUG(str) .debug = str
-#else
-#    define VSM_DEBUG(str)
-#endif
-
 // clang-format off
 #define VSM(key, a) [VSM_INDEX(key)] = { \
     .action = (a), \
-    VSM_DEBUG(#key " => " #a) \
 }
 #define VSM_HOLD(key, a) [VSM_INDEX(key)] = { \
     .action = (a), \
     .hold = true, \
-    VSM_DEBUG(#key " => " #a " (hold)") \
 }
 #define VSM_APPEND(key) [VSM_INDEX(key)] = { \
     .append = true, \
-    VSM_DEBUG(#key " => append to pending") \
 }
 #define VSM_APPEND_FIRST_THEN_ACTION(key, a) [VSM_INDEX(key)] = { \
     .action = (a), \
     .append = true, \
-    VSM_DEBUG(#key " => " #a " (append to pending)") \
 }
 #define VSM_APPEND_IF_PENDING(key, a) [VSM_INDEX(key)] = { \
     .action = (a), \
     .append_if_pending = true, \
-    VSM_DEBUG(#key " => " #a " (append if already pending)") \
+}
+#define VSM_ARGUMENT(key, a) [VSM_INDEX(key)] = { \
+    .action = (a), \
+    .argument = true, \
 }
 // clang-format on
 
-static const vim_statemachine_t vsm_command[VSM_SIZE] = {
+static VIM_SRAM_CONST vim_statemachine_t vsm_command[VSM_SIZE] PROGMEM = {
     VSM(KC_A, VIM_ACTION_RIGHT | VIM_ENTER_INSERT),
     VSM_HOLD(KC_B, VIM_ACTION_WORD_START),
     VSM_APPEND_FIRST_THEN_ACTION(KC_C, VIM_ACTION_LINE | VIM_MOD_DELETE | VIM_ENTER_INSERT),
@@ -67,14 +65,17 @@ static const vim_statemachine_t vsm_command[VSM_SIZE] = {
     VSM_HOLD(KC_J, VIM_ACTION_DOWN),
     VSM_HOLD(KC_K, VIM_ACTION_UP),
     VSM_HOLD(KC_L, VIM_ACTION_RIGHT),
+    VSM(KC_N, VIM_ACTION_SEARCH_NEXT),
     VSM(KC_O, VIM_ACTION_OPEN_LINE_DOWN | VIM_ENTER_INSERT),
     VSM_HOLD(KC_P, VIM_ACTION_PASTE),
+    VSM_ARGUMENT(KC_Q, VIM_ACTION_MACRO_RECORD),
     VSM(KC_S, VIM_ACTION_RIGHT | VIM_MOD_DELETE | VIM_ENTER_INSERT),
     VSM_HOLD(KC_U, VIM_ACTION_UNDO),
     VSM(KC_V, VIM_ENTER_VISUAL),
     VSM_HOLD(KC_W, VIM_ACTION_WORD_END),
     VSM_HOLD(KC_X, VIM_ACTION_RIGHT | VIM_MOD_DELETE),
     VSM_APPEND_FIRST_THEN_ACTION(KC_Y, VIM_ACTION_LINE | VIM_MOD_YANK),
+    VSM_ARGUMENT(KC_Z, VIM_ACTION_VIEW),
     VSM_APPEND(KC_1),
     VSM_APPEND(KC_2),
     VSM_APPEND(KC_3),
@@ -82,12 +83,14 @@ static const vim_statemachine_t vsm_command[VSM_SIZE] = {
     VSM_APPEND(KC_5),
     VSM_APPEND(KC_6),
     VSM_APPEND(KC_7),
-    VSM_APPEND(KC_9),
+    VSM_APPEND(KC_8),
     VSM_APPEND(KC_9),
     VSM_APPEND_IF_PENDING(KC_0, VIM_ACTION_LINE_START),
+    VSM(KC_DOT, VIM_ACTION_REPEAT),
+    VSM(KC_SLASH, VIM_ACTION_SEARCH),
 };
 
-static const vim_statemachine_t vsm_command_shift[VSM_SIZE] = {
+static VIM_SRAM_CONST vim_statemachine_t vsm_command_shift[VSM_SIZE] PROGMEM = {
     VSM(KC_A, VIM_ACTION_LINE_END | VIM_ENTER_INSERT),
     VSM_HOLD(KC_B, VIM_ACTION_WORD_START),
     VSM(KC_C, VIM_ACTION_LINE_END | VIM_MOD_DELETE | VIM_ENTER_INSERT),
@@ -96,32 +99,59 @@ static const vim_statemachine_t vsm_command_shift[VSM_SIZE] = {
     VSM_HOLD(KC_G, VIM_ACTION_DOCUMENT_END),
     VSM(KC_I, VIM_ACTION_LINE_START | VIM_ENTER_INSERT),
     VSM(KC_J, VIM_ACTION_JOIN_LINE),
+    VSM(KC_N, VIM_ACTION_SEARCH_PREVIOUS),
     VSM(KC_O, VIM_ACTION_OPEN_LINE_UP | VIM_ENTER_INSERT),
     VSM_HOLD(KC_P, VIM_ACTION_PASTE),
     VSM(KC_S, VIM_ACTION_LINE | VIM_MOD_DELETE | VIM_ENTER_INSERT),
+#ifndef VIM_NO_VLINE
     VSM(KC_V, VIM_ENTER_VLINE),
+#endif
     VSM_HOLD(KC_W, VIM_ACTION_WORD_END),
     VSM_HOLD(KC_X, VIM_ACTION_LEFT | VIM_MOD_DELETE),
     VSM(KC_Y, VIM_ACTION_LINE | VIM_MOD_YANK),
+    VSM_ARGUMENT(KC_2, VIM_ACTION_MACRO_PLAY),
+    VSM(KC_3, VIM_ACTION_SEARCH_WORD_BACKWARD),
     VSM_HOLD(KC_4, VIM_ACTION_LINE_END),
     VSM_HOLD(KC_6, VIM_ACTION_LINE_START),
+    VSM(KC_8, VIM_ACTION_SEARCH_WORD),
+    VSM(KC_SCLN, VIM_ENTER_EX),
+    VSM(KC_SLASH, VIM_ACTION_SEARCH_BACKWARD),
+};
+
+// looked up first while an operator is pending
+static VIM_SRAM_CONST vim_statemachine_t vsm_operator[VSM_SIZE] PROGMEM = {
+    VSM_ARGUMENT(KC_A, VIM_ACTION_OBJECT_AROUND),
+    VSM_ARGUMENT(KC_I, VIM_ACTION_OBJECT_INNER),
 };
 
-static const vim_statemachine_t vsm_command_ctrl[VSM_SIZE] = {
+static VIM_SRAM_CONST vim_statemachine_t vsm_command_ctrl[VSM_SIZE] PROGMEM = {
     VSM_HOLD(KC_B, VIM_ACTION_PAGE_UP),
     VSM_HOLD(KC_F, VIM_ACTION_PAGE_DOWN),
+#ifndef VIM_NO_VBLOCK
+    VSM(KC_V, VIM_ENTER_VBLOCK),
+#endif
+#ifdef MOUSE_ENABLE
+    // scroll the view only, with the mouse wheel
+    VSM(KC_D, VIM_ACTION_HALF_PAGE_DOWN),
+    VSM(KC_E, VIM_ACTION_SCROLL_DOWN),
+    VSM(KC_U, VIM_ACTION_HALF_PAGE_UP),
+    VSM(KC_Y, VIM_ACTION_SCROLL_UP),
+#endif
 };
 
-static const vim_statemachine_t vsm_visual[VSM_SIZE] = {
+static VIM_SRAM_CONST vim_statemachine_t vsm_visual[VSM_SIZE] PROGMEM = {
+    VSM_ARGUMENT(KC_A, VIM_ACTION_OBJECT_AROUND),
     VSM_HOLD(KC_B, VIM_ACTION_WORD_START | VIM_MOD_SELECT),
     VSM(KC_C, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_INSERT),
     VSM(KC_D, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_COMMAND),
     VSM_HOLD(KC_E, VIM_ACTION_WORD_END | VIM_MOD_SELECT),
     VSM_APPEND_FIRST_THEN_ACTION(KC_G, VIM_ACTION_DOCUMENT_START | VIM_MOD_SELECT),
     VSM_HOLD(KC_H, VIM_ACTION_LEFT | VIM_MOD_SELECT),
+    VSM_ARGUMENT(KC_I, VIM_ACTION_OBJECT_INNER),
     VSM_HOLD(KC_J, VIM_ACTION_DOWN | VIM_MOD_SELECT),
     VSM_HOLD(KC_K, VIM_ACTION_UP | VIM_MOD_SELECT),
     VSM_HOLD(KC_L, VIM_ACTION_RIGHT | VIM_MOD_SELECT),
+    VSM(KC_O, VIM_ACTION_SWAP_ENDS),
     VSM_HOLD(KC_P, VIM_ACTION_PASTE),
     VSM(KC_S, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_INSERT),
     VSM(KC_V, VIM_ENTER_COMMAND),
@@ -135,16 +165,19 @@ static const vim_statemachine_t vsm_visual[VSM_SIZE] = {
     VSM_APPEND(KC_5),
     VSM_APPEND(KC_6),
     VSM_APPEND(KC_7),
-    VSM_APPEND(KC_9),
+    VSM_APPEND(KC_8),
     VSM_APPEND(KC_9),
     VSM_APPEND_IF_PENDING(KC_0, VIM_ACTION_LINE_START | VIM_MOD_SELECT),
     VSM(KC_ESCAPE, VIM_ENTER_COMMAND),
 };
 
-static const vim_statemachine_t vsm_visual_shift[VSM_SIZE] = {
+static VIM_SRAM_CONST vim_statemachine_t vsm_visual_shift[VSM_SIZE] PROGMEM = {
     VSM(KC_C, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_INSERT),
     VSM(KC_D, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_COMMAND),
+    VSM(KC_O, VIM_ACTION_SWAP_ENDS),
+#ifndef VIM_NO_VLINE
     VSM(KC_V, VIM_ACTION_SELECTION | VIM_MOD_SELECT | VIM_ENTER_VLINE),
+#endif
     VSM(KC_X, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_COMMAND),
     VSM(KC_Y, VIM_ACTION_SELECTION | VIM_MOD_YANK | VIM_ENTER_COMMAND),
     VSM(KC_4, VIM_ACTION_LINE_END | VIM_MOD_SELECT),
@@ -152,12 +185,20 @@ static const vim_statemachine_t vsm_visual_shift[VSM_SIZE] = {
     VSM(KC_ESCAPE, VIM_ENTER_COMMAND),
 };
 
-static const vim_statemachine_t vsm_vline[VSM_SIZE] = {
+#ifndef VIM_NO_VBLOCK
+static VIM_SRAM_CONST vim_statemachine_t vsm_visual_ctrl[VSM_SIZE] PROGMEM = {
+    VSM(KC_V, VIM_ENTER_VBLOCK),
+};
+#endif
+
+#ifndef VIM_NO_VLINE
+static VIM_SRAM_CONST vim_statemachine_t vsm_vline[VSM_SIZE] PROGMEM = {
     VSM(KC_C, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_INSERT),
     VSM(KC_D, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_COMMAND),
     VSM_APPEND_FIRST_THEN_ACTION(KC_G, VIM_ACTION_DOCUMENT_START | VIM_MOD_SELECT),
     VSM_HOLD(KC_J, VIM_ACTION_DOWN | VIM_MOD_SELECT),
     VSM_HOLD(KC_K, VIM_ACTION_UP | VIM_MOD_SELECT),
+    VSM(KC_O, VIM_ACTION_SWAP_ENDS),
     VSM_HOLD(KC_P, VIM_ACTION_PASTE),
     VSM(KC_S, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_INSERT),
     VSM(KC_V, VIM_ENTER_VISUAL),
@@ -170,62 +211,121 @@ static const vim_statemachine_t vsm_vline[VSM_SIZE] = {
     VSM_APPEND(KC_5),
     VSM_APPEND(KC_6),
     VSM_APPEND(KC_7),
-    VSM_APPEND(KC_9),
+    VSM_APPEND(KC_8),
     VSM_APPEND(KC_9),
     VSM_APPEND(KC_0),
     VSM(KC_ESCAPE, VIM_ENTER_COMMAND),
 };
 
-static const vim_statemachine_t vsm_vline_shift[VSM_SIZE] = {
+static VIM_SRAM_CONST vim_statemachine_t vsm_vline_shift[VSM_SIZE] PROGMEM = {
     VSM(KC_C, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_INSERT),
     VSM(KC_D, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_COMMAND),
+    VSM(KC_O, VIM_ACTION_SWAP_ENDS),
     VSM(KC_V, VIM_ENTER_COMMAND),
     VSM(KC_X, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_COMMAND),
     VSM(KC_Y, VIM_ACTION_SELECTION | VIM_MOD_YANK | VIM_ENTER_COMMAND),
     VSM(KC_ESCAPE, VIM_ENTER_COMMAND),
 };
 
+#    ifndef VIM_NO_VBLOCK
+static VIM_SRAM_CONST vim_statemachine_t vsm_vline_ctrl[VSM_SIZE] PROGMEM = {
+    VSM(KC_V, VIM_ENTER_VBLOCK),
+};
+#    endif
+#endif
+
+#ifndef VIM_NO_VBLOCK
+// only h, j, k and l, so that the size of the block is known
+static VIM_SRAM_CONST vim_statemachine_t vsm_vblock[VSM_SIZE] PROGMEM = {
+    VSM(KC_C, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_INSERT),
+    VSM(KC_D, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_COMMAND),
+    VSM_HOLD(KC_H, VIM_ACTION_LEFT | VIM_MOD_SELECT),
+    VSM_HOLD(KC_J, VIM_ACTION_DOWN | VIM_MOD_SELECT),
+    VSM_HOLD(KC_K, VIM_ACTION_UP | VIM_MOD_SELECT),
+    VSM_HOLD(KC_L, VIM_ACTION_RIGHT | VIM_MOD_SELECT),
+    VSM(KC_S, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_INSERT),
+    VSM(KC_V, VIM_ENTER_COMMAND),
+    VSM(KC_X, VIM_ACTION_SELECTION | VIM_MOD_DELETE | VIM_ENTER_COMMAND),
+    VSM(KC_Y, VIM_ACTION_SELECTION | VIM_MOD_YANK | VIM_ENTER_COMMAND),
+    VSM_APPEND(KC_1),
+    VSM_APPEND(KC_2),
+    VSM_APPEND(KC_3),
+    VSM_APPEND(KC_4),
+    VSM_APPEND(KC_5),
+    VSM_APPEND(KC_6),
+    VSM_APPEND(KC_7),
+    VSM_APPEND(KC_8),
+    VSM_APPEND(KC_9),
+    VSM_APPEND(KC_0),
+    VSM(KC_ESCAPE, VIM_ENTER_COMMAND),
+};
+
+static VIM_SRAM_CONST vim_statemachine_t vsm_vblock_ctrl[VSM_SIZE] PROGMEM = {
+    VSM(KC_V, VIM_ENTER_COMMAND),
+};
+#endif
+
 #undef VSM
-#undef VSM_DEBUG
 #undef VSM_HOLD
 #undef VSM_APPEND
 #undef VSM_APPEND_IF_PENDING
 #undef VSM_APPEND_THEN_ACTION
+#undef VSM_ARGUMENT
 
-const vim_statemachine_t *vim_lookup_statemachine(uint16_t keycode) {
-    if (keycode < VSM_FIRST || keycode > VSM_LAST) {
-        return NULL;
-    }
+// The keys let through by default, see VIM_PASSTHROUGH_TABLE in host.h
+// clang-format off
+VIM_SRAM_CONST uint8_t vim_passthrough_command[32] PROGMEM = VIM_PASSTHROUGH_TABLE(VIM_PASSTHROUGH_COMMAND);
+VIM_SRAM_CONST uint8_t vim_passthrough_visual[32] PROGMEM  = VIM_PASSTHROUGH_TABLE(VIM_PASSTHROUGH_ANY);
+// clang-format on
 
-    uint8_t vim_mods = vim_get_mods();
-    uint8_t index    = VSM_INDEX(keycode);
-    bool    ctrl     = (vim_mods == MOD_BIT(KC_LCTL)) || (vim_mods == MOD_BIT(KC_RCTL));
-    bool    shift    = (vim_mods == MOD_BIT(KC_LSFT)) || (vim_mods == MOD_BIT(KC_RSFT));
+static const vim_statemachine_t *vim_lookup_table(void) {
+    vim_mod_class_t mods = vim_get_mod_class();
 
     switch (vim_get_mode()) {
         case VIM_MODE_COMMAND:
-            if (ctrl) {
-                return &vsm_command_ctrl[index];
-            } else if (shift) {
-                return &vsm_command_shift[index];
-            } else if (vim_mods == 0) {
-                return &vsm_command[index];
+            if (mods == VIM_MOD_CLASS_CTRL) {
+                return vsm_command_ctrl;
+            } else if (mods == VIM_MOD_CLASS_SHIFT) {
+                return vsm_command_shift;
+            } else if (mods == VIM_MOD_CLASS_NONE) {
+                return vsm_command;
             }
             break;
         case VIM_MODE_VISUAL:
-            if (vim_mods == 0) {
-                return &vsm_visual[index];
-            } else if (shift) {
-                return &vsm_visual_shift[index];
+            if (mods == VIM_MOD_CLASS_NONE) {
+                return vsm_visual;
+            } else if (mods == VIM_MOD_CLASS_SHIFT) {
+                return vsm_visual_shift;
+            }
+#ifndef VIM_NO_VBLOCK
+            if (mods == VIM_MOD_CLASS_CTRL) {
+                return vsm_visual_ctrl;
             }
+#endif
             break;
+#ifndef VIM_NO_VLINE
         case VIM_MODE_VLINE:
-            if (vim_mods == 0) {
-                return &vsm_vline[index];
-            } else if (shift) {
-                return &vsm_vline_shift[index];
+            if (mods == VIM_MOD_CLASS_NONE) {
+                return vsm_vline;
+            } else if (mods == VIM_MOD_CLASS_SHIFT) {
+                return vsm_vline_shift;
+            }
+#    ifndef VIM_NO_VBLOCK
+            if (mods == VIM_MOD_CLASS_CTRL) {
+                return vsm_vline_ctrl;
             }
+#    endif
             break;
+#endif
+#ifndef VIM_NO_VBLOCK
+        case VIM_MODE_VBLOCK:
+            if (mods == VIM_MOD_CLASS_NONE) {
+                return vsm_vblock;
+            } else if (mods == VIM_MOD_CLASS_CTRL) {
+                return vsm_vblock_ctrl;
+            }
+            break;
+#endif
         default:
             break;
     }
@@ -233,15 +333,54 @@ const vim_statemachine_t *vim_lookup_statemachine(uint16_t keycode) {
     return NULL;
 }
 
+bool VIM_SRAM_FUNC(vim_lookup_statemachine)(uint16_t keycode, vim_statemachine_t *state) {
+    if (keycode < VSM_FIRST || keycode > VSM_LAST) {
+        return false;
+    }
+    const vim_statemachine_t *table = vim_lookup_table();
+    if (!table) {
+        return false;
+    }
+    if (table == vsm_command && vim_is_operator(vim_get_pending().keycode)) {
+        memcpy_P(state, &vsm_operator[VSM_INDEX(keycode)], sizeof(vim_statemachine_t));
+        if (state->action != VIM_ACTION_NONE) {
+            return true;
+        }
+    }
+    memcpy_P(state, &table[VSM_INDEX(keycode)], sizeof(vim_statemachine_t));
+    return true;
+}
+
 bool vim_is_active_key(uint16_t keycode) {
     if (vim_get_mode() == VIM_MODE_INSERT) {
         return false;
     }
 
-    const vim_statemachine_t *state = vim_lookup_statemachine(keycode);
-    return state != NULL && state->action != VIM_ACTION_NONE;
+    vim_statemachine_t state;
+    return vim_lookup_statemachine(keycode, &state) && state.action != VIM_ACTION_NONE;
 }
 
-void vim_dprintf_state(const vim_statemachine_t *state) {
-    VIM_DPRINTF("state=%s\n", state ? state->debug : "NULL");
+bool VIM_SRAM_FUNC(vim_is_passthrough)(uint16_t keycode) {
+    if (!IS_QK_BASIC(keycode)) {
+        // QK_BOOT, lighting, and the keyboard's and keymap's own keycodes
+        return true;
+    }
+    if (vim_get_mods() & vim_host_profile()->passthrough_mods) {
+        // Ctrl+S, Alt+Tab, or Cmd+Q
+        return true;
+    }
+    const uint8_t *table;
+    switch (vim_get_mode()) {
+        case VIM_MODE_COMMAND:
+            table = vim_host_profile()->passthrough_command;
+            break;
+        case VIM_MODE_VISUAL:
+        case VIM_MODE_VLINE:
+        case VIM_MODE_VBLOCK:
+            table = vim_host_profile()->passthrough_visual;
+            break;
+        default:
+            return false;
+    }
+    return pgm_read_byte(&table[keycode >> 3]) & (1 << (keycode & 7));
 }
@@ -45,6 +45,25 @@ typedef enum {
     VIM_ACTION_OPEN_LINE_UP,
     VIM_ACTION_OPEN_LINE_DOWN,
     VIM_ACTION_JOIN_LINE,
+    VIM_ACTION_REPEAT,
+    VIM_ACTION_MACRO_RECORD,
+    VIM_ACTION_MACRO_PLAY,
+    VIM_ACTION_SWAP_ENDS,
+    VIM_ACTION_RESELECT,
+    VIM_ACTION_OBJECT_INNER,
+    VIM_ACTION_OBJECT_AROUND,
+    VIM_ACTION_SCROLL_DOWN,
+    VIM_ACTION_SCROLL_UP,
+    VIM_ACTION_HALF_PAGE_DOWN,
+    VIM_ACTION_HALF_PAGE_UP,
+    VIM_ACTION_VIEW,
+    VIM_ACTION_SEARCH,
+    VIM_ACTION_SEARCH_BACKWARD,
+    VIM_ACTION_SEARCH_NEXT,
+    VIM_ACTION_SEARCH_PREVIOUS,
+    VIM_ACTION_SEARCH_WORD,
+    VIM_ACTION_SEARCH_WORD_BACKWARD,
+    VIM_ACTION_COUNT,
 
     VIM_MOD_DELETE = 0x0100,
     VIM_MOD_SELECT = 0x0200,
@@ -53,27 +72,34 @@ typedef enum {
     VIM_ENTER_INSERT  = VIM_MODE_ACTION(VIM_MODE_INSERT),
     VIM_ENTER_COMMAND = VIM_MODE_ACTION(VIM_MODE_COMMAND),
     VIM_ENTER_VISUAL  = VIM_MODE_ACTION(VIM_MODE_VISUAL),
-    VIM_ENTER_VLINE  = VIM_MODE_ACTION(VIM_MODE_VLINE),
+    VIM_ENTER_VLINE   = VIM_MODE_ACTION(VIM_MODE_VLINE),
+    VIM_ENTER_EX      = VIM_MODE_ACTION(VIM_MODE_EX),
+    VIM_ENTER_VBLOCK  = VIM_MODE_ACTION(VIM_MODE_VBLOCK),
 
     VIM_MASK_ACTION = 0x00ff,
     VIM_MASK_MOD    = 0x0f00,
     VIM_MASK_MODE   = 0xf000
 } vim_action_t;
 
-typedef struct {
+// Packed into three bytes, the tables are kept in flash on AVR.
+typedef struct __attribute__((packed)) {
+    vim_action_t action : 16;
     bool         append : 1;
     bool         append_if_pending : 1;
     bool         hold : 1;
-    vim_action_t action;
-#ifdef VIM_DEBUG
-    const char *debug;
-#endif
+    bool         argument : 1;
 } vim_statemachine_t;
 
-const vim_statemachine_t *vim_lookup_statemachine(uint16_t keycode);
+// Copies the entry for the keycode in the current mode into state, returns
+// false for keys that aren't mapped in it at all.
+bool vim_lookup_statemachine(uint16_t keycode, vim_statemachine_t *state);
+
+// Returns true for keys that aren't mapped in the current mode but go to the
+// host without leaving it: the keys in the mode's passthrough table, any key
+// with one of the host profile's passthrough_mods held, and the keycodes
+// beyond the basic ones.
+bool vim_is_passthrough(uint16_t keycode);
 
 // Returns true for keys that are mapped in the current VIM mode.
 // Useful for indicating the current mode using RGB matrix lights.
 bool vim_is_active_key(uint16_t keycode);
-
-void vim_dprintf_state(const vim_statemachine_t *state);
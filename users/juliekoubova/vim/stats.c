@@ -0,0 +1,162 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stats.h"
+
+#ifdef VIM_STATS
+#    include "eeprom.h"
+#    include "quantum/quantum.h"
+#    include <string.h>
+
+#    ifndef VIM_STATS_SAVE_INTERVAL
+#        define VIM_STATS_SAVE_INTERVAL (15UL * 60 * 1000)
+#    endif
+
+// the first byte of a raw HID report asking for the counters
+#    ifndef VIM_STATS_RAW_HID_ID
+#        define VIM_STATS_RAW_HID_ID 0x76
+#    endif
+
+#    define VIM_STATS_MAGIC 0x5356
+
+// The dump format is this struct, little-endian. Counts and modes go first, so
+// that the tools can read dumps of firmware with more or fewer actions.
+typedef struct {
+    uint16_t magic;
+    uint8_t  modes;
+    uint8_t  actions;
+    uint16_t counters[VIM_MODE_COUNT][VIM_ACTION_COUNT];
+    uint16_t mode_switches[VIM_MODE_COUNT];
+    uint16_t operators[VIM_STATS_OPERATORS]; // c, d, y
+    uint16_t counted;
+    uint16_t abandoned;
+} vim_stats_t;
+
+_Static_assert(sizeof(vim_stats_t) == VIM_STATS_STORAGE_SIZE, "update VIM_STATS_STORAGE_SIZE");
+
+static vim_stats_t vim_stats;
+static bool        vim_stats_dirty = false;
+static uint32_t    vim_stats_saved = 0;
+
+static void vim_stats_clear(void) {
+    memset(&vim_stats, 0, sizeof(vim_stats));
+    vim_stats.magic   = VIM_STATS_MAGIC;
+    vim_stats.modes   = VIM_MODE_COUNT;
+    vim_stats.actions = VIM_ACTION_COUNT;
+}
+
+static void vim_stats_increment(uint16_t *counter) {
+    if (*counter < UINT16_MAX) {
+        ++*counter;
+    }
+    vim_stats_dirty = true;
+}
+
+void vim_stats_init(void) {
+    eeconfig_read_user_datablock(&vim_stats, VIM_EEPROM_STATS_OFFSET, sizeof(vim_stats));
+    if (vim_stats.magic != VIM_STATS_MAGIC || vim_stats.modes != VIM_MODE_COUNT ||
+        vim_stats.actions != VIM_ACTION_COUNT) {
+        vim_stats_clear();
+    }
+    vim_stats_saved = timer_read32();
+}
+
+void vim_stats_save(void) {
+    if (vim_stats_dirty) {
+        eeconfig_update_user_datablock(&vim_stats, VIM_EEPROM_STATS_OFFSET, sizeof(vim_stats));
+        vim_stats_dirty = false;
+    }
+    vim_stats_saved = timer_read32();
+}
+
+void vim_stats_task(void) {
+    if (vim_stats_dirty && timer_elapsed32(vim_stats_saved) >= VIM_STATS_SAVE_INTERVAL) {
+        vim_stats_save();
+    }
+}
+
+void vim_stats_action(vim_action_t action, vim_pending_t pending) {
+    vim_mode_t mode = vim_get_mode();
+    uint8_t    index = action & VIM_MASK_ACTION;
+    if (index == VIM_ACTION_NONE || mode >= VIM_MODE_COUNT || index >= VIM_ACTION_COUNT) {
+        return;
+    }
+    vim_stats_increment(&vim_stats.counters[mode][index]);
+    if (pending.repeat) {
+        vim_stats_increment(&vim_stats.counted);
+    }
+    switch (pending.keycode) {
+        case KC_C:
+            vim_stats_increment(&vim_stats.operators[0]);
+            break;
+        case KC_D:
+            vim_stats_increment(&vim_stats.operators[1]);
+            break;
+        case KC_Y:
+            vim_stats_increment(&vim_stats.operators[2]);
+            break;
+        default:
+            break;
+    }
+}
+
+void vim_stats_abandoned(void) {
+    vim_stats_increment(&vim_stats.abandoned);
+}
+
+void vim_stats_mode(vim_mode_t mode) {
+    if (mode < VIM_MODE_COUNT) {
+        vim_stats_increment(&vim_stats.mode_switches[mode]);
+    }
+}
+
+// Prints the counters as `vimstats:` hex lines, for tools/vim_stats_report.py.
+void vim_stats_dump(void) {
+    static const char hex[] = "0123456789abcdef";
+    const uint8_t    *bytes = (const uint8_t *)&vim_stats;
+    char              line[33];
+    for (uint16_t offset = 0; offset < sizeof(vim_stats); offset += 16) {
+        uint8_t length = 0;
+        for (uint16_t i = offset; i < offset + 16 && i < sizeof(vim_stats); i++) {
+            line[length++] = hex[bytes[i] >> 4];
+            line[length++] = hex[bytes[i] & 0xf];
+        }
+        line[length] = 0;
+        xprintf("vimstats:%s\n", line);
+    }
+    xprintf("vimstats:end\n");
+}
+
+// Call this from raw_hid_receive. A report starting with VIM_STATS_RAW_HID_ID
+// and a little-endian offset gets back the counters from that offset on, after
+// the same three bytes.
+bool vim_stats_raw_hid(uint8_t *data, uint8_t length) {
+    if (length < 4 || data[0] != VIM_STATS_RAW_HID_ID) {
+        return false;
+    }
+    uint16_t offset = data[1] | (data[2] << 8);
+    uint8_t  count  = length - 3;
+    memset(data + 3, 0, count);
+    if (offset < sizeof(vim_stats)) {
+        if (count > sizeof(vim_stats) - offset) {
+            count = sizeof(vim_stats) - offset;
+        }
+        memcpy(data + 3, (const uint8_t *)&vim_stats + offset, count);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,59 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "pending.h"
+#include "statemachine.h"
+#include "vim_mode.h"
+
+// With VIM_STATS, the keyboard counts which commands get used, in which mode,
+// how often with a count, and how often an operator is abandoned. The counters
+// saturate, and are only written to EEPROM every VIM_STATS_SAVE_INTERVAL.
+#ifndef VIM_STATS_COMMAND_KEY
+#    define VIM_STATS_COMMAND_KEY KC_S
+#endif
+
+// the counters are all 16-bit, after a 4 byte header
+#define VIM_STATS_STORAGE_SIZE \
+    (4 + 2 * (VIM_MODE_COUNT * VIM_ACTION_COUNT + VIM_MODE_COUNT + VIM_STATS_OPERATORS + 2))
+#define VIM_STATS_OPERATORS 3
+
+#ifdef VIM_STATS
+
+void vim_stats_init(void);
+void vim_stats_task(void);
+void vim_stats_save(void);
+void vim_stats_action(vim_action_t action, vim_pending_t pending);
+void vim_stats_abandoned(void);
+void vim_stats_mode(vim_mode_t mode);
+void vim_stats_dump(void);
+bool vim_stats_raw_hid(uint8_t *data, uint8_t length);
+
+#else
+
+static inline void vim_stats_init(void) {}
+static inline void vim_stats_task(void) {}
+static inline void vim_stats_save(void) {}
+static inline void vim_stats_action(vim_action_t action, vim_pending_t pending) {}
+static inline void vim_stats_abandoned(void) {}
+static inline void vim_stats_mode(vim_mode_t mode) {}
+static inline bool vim_stats_raw_hid(uint8_t *data, uint8_t length) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,126 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timer_wheel.h"
+#include "debug.h"
+#include "platforms/timer.h"
+
+#ifndef VIM_TIMER_WHEEL_SIZE
+#    define VIM_TIMER_WHEEL_SIZE 16
+#endif
+
+// every bucket of the wheel covers 1 << VIM_TIMER_TICK_SHIFT milliseconds
+#ifndef VIM_TIMER_TICK_SHIFT
+#    define VIM_TIMER_TICK_SHIFT 2
+#endif
+
+_Static_assert((VIM_TIMER_WHEEL_SIZE & (VIM_TIMER_WHEEL_SIZE - 1)) == 0,
+               "VIM_TIMER_WHEEL_SIZE must be a power of two");
+_Static_assert(VIM_TIMER_COUNT <= 8, "due timers are tracked in a uint8_t");
+
+#define VIM_TIMER_BUCKET(ms) (((ms) >> VIM_TIMER_TICK_SHIFT) & (VIM_TIMER_WHEEL_SIZE - 1))
+
+// list links hold the timer id + 1, so that a zeroed wheel is an empty one
+typedef struct {
+    vim_timer_callback_t callback;
+    uint16_t             expires;
+    uint8_t              prev;
+    uint8_t              next;
+    bool                 scheduled;
+} vim_timer_t;
+
+static vim_timer_t vim_timers[VIM_TIMER_COUNT];
+static uint8_t     vim_wheel[VIM_TIMER_WHEEL_SIZE];
+static uint16_t    vim_wheel_tick   = 0;
+static uint8_t     vim_timers_due   = 0;
+static uint8_t     vim_timers_count = 0;
+
+static void vim_timer_unlink(vim_timer_id_t id) {
+    vim_timer_t *timer = &vim_timers[id];
+    if (timer->prev) {
+        vim_timers[timer->prev - 1].next = timer->next;
+    } else {
+        vim_wheel[VIM_TIMER_BUCKET(timer->expires)] = timer->next;
+    }
+    if (timer->next) {
+        vim_timers[timer->next - 1].prev = timer->prev;
+    }
+    timer->scheduled = false;
+    vim_timers_count--;
+}
+
+void vim_timer_schedule(vim_timer_id_t id, uint16_t delay, vim_timer_callback_t callback) {
+    vim_timer_cancel(id);
+
+    vim_timer_t *timer = &vim_timers[id];
+    uint8_t     *head  = &vim_wheel[VIM_TIMER_BUCKET(timer->expires = timer_read() + delay)];
+    timer->callback    = callback;
+    timer->prev        = 0;
+    timer->next        = *head;
+    timer->scheduled   = true;
+    if (*head) {
+        vim_timers[*head - 1].prev = id + 1;
+    }
+    *head = id + 1;
+    vim_timers_count++;
+}
+
+void vim_timer_cancel(vim_timer_id_t id) {
+    vim_timers_due &= ~(1 << id);
+    if (vim_timers[id].scheduled) {
+        vim_timer_unlink(id);
+    }
+}
+
+bool vim_timer_is_scheduled(vim_timer_id_t id) {
+    return vim_timers[id].scheduled || (vim_timers_due & (1 << id));
+}
+
+// Visits the buckets passed since the last tick, at most one full turn of the
+// wheel. Timers that are due are unlinked first and only then called, so the
+// callbacks are free to schedule or cancel any timer, including their own.
+void vim_timer_tick(uint16_t now) {
+    uint16_t now_tick = now >> VIM_TIMER_TICK_SHIFT;
+    if (vim_timers_count == 0) {
+        vim_wheel_tick = now_tick;
+        return;
+    }
+
+    // the ticks wrap around along with the 16-bit millisecond timer
+    uint16_t buckets = (now_tick - vim_wheel_tick) & (UINT16_MAX >> VIM_TIMER_TICK_SHIFT);
+    if (buckets >= VIM_TIMER_WHEEL_SIZE) {
+        buckets = VIM_TIMER_WHEEL_SIZE - 1;
+    }
+    for (uint16_t tick = vim_wheel_tick; tick != (uint16_t)(vim_wheel_tick + buckets + 1); tick++) {
+        uint8_t link = vim_wheel[tick & (VIM_TIMER_WHEEL_SIZE - 1)];
+        while (link) {
+            vim_timer_id_t id = link - 1;
+            link              = vim_timers[id].next;
+            if ((int16_t)(now - vim_timers[id].expires) >= 0) {
+                vim_timer_unlink(id);
+                vim_timers_due |= 1 << id;
+            }
+        }
+    }
+    vim_wheel_tick = now_tick;
+
+    for (vim_timer_id_t id = 0; vim_timers_due; id++) {
+        if (vim_timers_due & (1 << id)) {
+            vim_timers_due &= ~(1 << id);
+            vim_timers[id].callback();
+        }
+    }
+}
@@ -0,0 +1,37 @@
+/* Copyright 2024 (c) Julie Koubova (julie@koubova.net)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// Every client owns exactly one timer slot, so scheduling never allocates and
+// rescheduling a slot simply moves it.
+typedef enum {
+    VIM_TIMER_EMIT,
+    VIM_TIMER_AUTOREPEAT,
+    VIM_TIMER_VLINE,
+    VIM_TIMER_PENDING,
+    VIM_TIMER_MACRO,
+    VIM_TIMER_COUNT,
+} vim_timer_id_t;
+
+typedef void (*vim_timer_callback_t)(void);
+
+void vim_timer_schedule(vim_timer_id_t id, uint16_t delay, vim_timer_callback_t callback);
+void vim_timer_cancel(vim_timer_id_t id);
+bool vim_timer_is_scheduled(vim_timer_id_t id);
+void vim_timer_tick(uint16_t now);
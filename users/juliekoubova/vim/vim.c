@@ -16,20 +16,70 @@
 
 #include "debug.h"
 #include "vim_mode.h"
+#include "ex.h"
+#include "fast_path.h"
+#include "host.h"
+#include "invariants.h"
+#include "macro.h"
 #include "pending.h"
 #include "perform_action.h"
+#include "profile.h"
+#include "recorder.h"
+#include "repeat.h"
+#include "search.h"
+#include "snapshot.h"
+#include "sram.h"
 #include "statemachine.h"
+#include "stats.h"
+#include "timer_wheel.h"
+#include "vim_send.h"
 #include <stdbool.h>
 
-void vim_process_command(uint16_t keycode, const keyrecord_t *record) {
-    const vim_statemachine_t *state = vim_lookup_statemachine(keycode);
-    vim_dprintf_state(state);
-    if (!state) {
-        return;
+static uint16_t current_vim_keycode = KC_NO;
+
+uint8_t vim_slow_path = 0;
+
+// Returns true for the keys that QMK should send to the host.
+bool VIM_SRAM_FUNC(vim_process_command)(uint16_t keycode, const keyrecord_t *record) {
+    if (record->event.pressed && vim_get_pending().argument != VIM_ACTION_NONE) {
+        vim_perform_argument(keycode);
+        return false;
+    }
+    VIM_PROFILE_BEGIN(lookup);
+    vim_statemachine_t entry;
+    bool               found = vim_lookup_statemachine(keycode, &entry);
+    VIM_PROFILE_END(lookup, VIM_PROBE_LOOKUP);
+    if (found) {
+        VIM_LOG(STATE, entry.action);
+    } else {
+        VIM_LOG(STATE_NONE);
     }
+    if ((!found || (entry.action == VIM_ACTION_NONE && !entry.append)) &&
+        vim_is_passthrough(keycode)) {
+        uint8_t mods = vim_get_mods();
+        VIM_LOG(PASSTHROUGH, keycode, mods);
+        if (!record->event.pressed) {
+            // mods pressed since don't keep the key held on the host
+            return true;
+        }
+        // like any other key that isn't mapped, it cancels what's pending
+        vim_clear_pending();
+        if (mods == 0 || !IS_QK_BASIC(keycode)) {
+            return true;
+        }
+        // the mods are kept off the host in command mode, so the chord is
+        // sent as a whole
+        vim_send(((mods | mods >> 4) & 0x0f) << 8 | keycode, VIM_SEND_TAP);
+        return false;
+    }
+    if (!found) {
+        return false;
+    }
+    const vim_statemachine_t *state = &entry;
     if (record->event.pressed) {
         if (state->append_if_pending) {
-            if (vim_has_pending()) {
+            // `10j` but `d0`
+            if (vim_get_pending().repeat > 0) {
                 vim_append_pending(keycode);
             } else if (state->action) {
                 vim_perform_action(state->action, VIM_SEND_TAP);
@@ -38,6 +88,8 @@ void vim_process_command(uint16_t keycode, const keyrecord_t *record) {
             vim_perform_action(state->action, VIM_SEND_TAP);
         } else if (state->append) {
             vim_append_pending(keycode);
+        } else if (state->argument) {
+            vim_set_pending_argument(state->action);
         } else if (state->hold) {
             vim_perform_action(state->action, VIM_SEND_PRESS);
         } else {
@@ -46,21 +98,27 @@ void vim_process_command(uint16_t keycode, const keyrecord_t *record) {
     } else if (state->hold) {
         vim_perform_action(state->action, VIM_SEND_RELEASE);
     }
+    return false;
 }
 
 void vim_process_vim_key(bool pressed) {
     if (pressed) {
-        if (vim_get_mode() == VIM_MODE_INSERT) {
-            VIM_DPRINT("Vim key pressed in insert mode\n");
+        if (vim_get_mode() == VIM_MODE_SEARCH) {
+            // back to command mode, like Esc
+            VIM_LOG(VIM_KEY_COMMAND);
+            vim_set_vim_key_state(VIM_KEY_NONE);
+            vim_search_cancel();
+        } else if (vim_get_mode() == VIM_MODE_INSERT) {
+            VIM_LOG(VIM_KEY_INSERT);
             vim_set_vim_key_state(VIM_KEY_TAP);
             vim_enter_command_mode(false);
         } else {
-            VIM_DPRINT("Vim key pressed in non-insert mode\n");
+            VIM_LOG(VIM_KEY_COMMAND);
             vim_set_vim_key_state(VIM_KEY_NONE);
             vim_enter_insert_mode();
         }
     } else {
-        VIM_DPRINTF("Vim key released, vim_key_state=%d\n", vim_get_vim_key_state());
+        VIM_LOG(VIM_KEY_RELEASED, vim_get_vim_key_state());
         switch (vim_set_vim_key_state(VIM_KEY_NONE)) {
             case VIM_KEY_NONE:
                 // set when visual mode is entered from a vi key tap.
@@ -76,33 +134,225 @@ void vim_process_vim_key(bool pressed) {
     }
 }
 
-bool vim_process_record_logged(uint16_t keycode, const keyrecord_t *record, uint16_t vim_keycode) {
+// The mod bits of the five-bit mods in QK_MODS and QK_MOD_TAP keycodes
+static uint8_t vim_mod_bits(uint8_t mods) {
+    return (mods & 0x10) ? (mods & 0x0f) << 4 : mods;
+}
+
+// shifted symbols like `$` whose press went through vim_send
+static uint8_t vim_queued_mods_keys[256 / 8];
+static uint8_t vim_queued_mods_count = 0;
+
+// vim_send holds the mods of a queued `$` itself, not as QMK's weak mods, so
+// its release has to be queued too, even once nothing else is. Returns whether
+// the key goes through vim_send.
+static bool vim_queue_mods_key(uint16_t keycode, bool pressed, bool queue) {
+    uint8_t *keys = &vim_queued_mods_keys[QK_MODS_GET_BASIC_KEYCODE(keycode) >> 3];
+    uint8_t  bit  = 1 << (keycode & 7);
+    if (*keys & bit) {
+        *keys &= ~bit;
+        vim_queued_mods_count--;
+        queue |= !pressed;
+    }
+    if (queue && pressed) {
+        *keys |= bit;
+        vim_queued_mods_count++;
+    }
+    vim_set_slow_path(VIM_SLOW_PATH_HELD, vim_queued_mods_count);
+    return queue;
+}
+
+// The mods QMK holds for a key that isn't a basic one
+static uint8_t vim_key_held_mods(uint16_t keycode, const keyrecord_t *record) {
+    if (IS_QK_LAYER_MOD(keycode)) {
+        return vim_mod_bits(QK_LAYER_MOD_GET_MODS(keycode));
+    }
+    if (IS_QK_ONE_SHOT_MOD(keycode)) {
+        return vim_mod_bits(QK_ONE_SHOT_MOD_GET_MODS(keycode));
+    }
+    if (IS_QK_MOD_TAP(keycode) && record->tap.count == 0) {
+        return vim_mod_bits(QK_MOD_TAP_GET_MODS(keycode));
+    }
+    return 0;
+}
+
+// The keycode has already been looked up through the layer stack, and QMK
+// remembers the layer each key was pressed on, so that its release resolves to
+// the same keycode. Only the layer keys themselves have to be let through, so
+// that counts and symbols can be typed from other layers.
+static bool vim_is_layer_key(uint16_t keycode, const keyrecord_t *record) {
+    return IS_QK_MOMENTARY(keycode) || IS_QK_TO(keycode) || IS_QK_TOGGLE_LAYER(keycode) ||
+           IS_QK_ONE_SHOT_LAYER(keycode) || IS_QK_LAYER_TAP_TOGGLE(keycode) ||
+           IS_QK_DEF_LAYER(keycode) ||
+           (IS_QK_LAYER_TAP(keycode) && record->tap.count == 0);
+}
+
+static bool vim_process_command_key(uint16_t keycode, const keyrecord_t *record) {
+    if (vim_get_mode() == VIM_MODE_EX) {
+        vim_ex_process(keycode, record);
+        return false;
+    }
+    bool passthrough = vim_process_command(keycode, record);
+    vim_oneshot_key(keycode, record->event.pressed);
+    return passthrough;
+}
+
+bool VIM_SRAM_FUNC(vim_process_record_logged)(uint16_t keycode, const keyrecord_t *record, uint16_t vim_keycode) {
     if (keycode == vim_keycode) {
         vim_process_vim_key(record->event.pressed);
         return false;
     }
-    if (vim_get_mode() != VIM_MODE_INSERT) {
+    if (vim_get_mode() == VIM_MODE_SEARCH && vim_search_process(keycode, record)) {
+        return false;
+    }
+    if (!VIM_PASSES_KEYS(vim_get_mode())) {
         if (vim_get_vim_key_state() != VIM_KEY_NONE && record->event.pressed) {
             vim_set_vim_key_state(VIM_KEY_HELD);
         }
+        if (vim_is_layer_key(keycode, record)) {
+            return true;
+        }
+        if (IS_QK_LAYER_MOD(keycode)) {
+            // the layer goes to QMK, but the mods stay off the host
+            if (record->event.pressed) {
+                layer_on(QK_LAYER_MOD_GET_LAYER(keycode));
+            } else {
+                layer_off(QK_LAYER_MOD_GET_LAYER(keycode));
+            }
+            vim_update_mods(vim_mod_bits(QK_LAYER_MOD_GET_MODS(keycode)), record->event.pressed);
+            return false;
+        }
+        if (IS_QK_ONE_SHOT_MOD(keycode)) {
+            vim_process_oneshot_mods(vim_mod_bits(QK_ONE_SHOT_MOD_GET_MODS(keycode)),
+                                     record->event.pressed);
+            return false;
+        }
+        if (IS_QK_MOD_TAP(keycode)) {
+            if (record->tap.count == 0) {
+                vim_update_mods(vim_mod_bits(QK_MOD_TAP_GET_MODS(keycode)), record->event.pressed);
+                return false;
+            }
+            keycode = QK_MOD_TAP_GET_TAP_KEYCODE(keycode);
+        } else if (IS_QK_LAYER_TAP(keycode)) {
+            keycode = QK_LAYER_TAP_GET_TAP_KEYCODE(keycode);
+        }
         if (IS_MODIFIER_KEYCODE(keycode)) {
             vim_set_mod(keycode, record->event.pressed);
             return false;
         }
-        VIM_DPRINTF("vim_key_state=%d\n", vim_get_vim_key_state());
-        vim_process_command(keycode, record);
+        VIM_LOG(VIM_KEY_STATE, vim_get_vim_key_state());
+#ifdef CAPS_WORD_ENABLE
+        // double-tapping Shift turns it on in any mode, and its weak Shift
+        // would end up in what's sent
+        if (is_caps_word_on()) {
+            caps_word_off();
+        }
+#endif
+        uint8_t key_mods = vim_take_oneshot_mods(keycode, record->event.pressed);
+        if (IS_QK_MODS(keycode)) {
+            // shifted symbols on another layer, e.g. `$`. the mode change
+            // released one that was queued.
+            vim_queue_mods_key(keycode, record->event.pressed, false);
+            key_mods |= vim_mod_bits(QK_MODS_GET_MODS(keycode));
+            keycode = QK_MODS_GET_BASIC_KEYCODE(keycode);
+        }
+        vim_set_key_mods(key_mods);
+        bool passthrough = vim_process_command_key(keycode, record);
+        vim_set_key_mods(0);
+        if (!passthrough) {
+            return false;
+        }
+    } else if (record->event.pressed && vim_is_oneshot_chord(keycode)) {
+        vim_enter_oneshot();
+        return false;
+    } else {
+        vim_repeat_insert_key(keycode, record);
+    }
+    bool queued = vim_send_busy();
+    if (IS_QK_MODS(keycode)) {
+        queued = vim_queue_mods_key(keycode, record->event.pressed, queued);
+    }
+    if (queued && (IS_QK_BASIC(keycode) || IS_QK_MODS(keycode))) {
+        // a command is still being sent, the key has to wait for it
+        vim_send(keycode, record->event.pressed ? VIM_SEND_PRESS : VIM_SEND_RELEASE);
         return false;
     }
+    if (!record->event.pressed) {
+        // QMK releases the mods of LM() and the like right away
+        vim_send_release_mods(vim_key_held_mods(keycode, record));
+    }
     return true;
 }
 
-bool process_record_vim(uint16_t keycode, const keyrecord_t *record, uint16_t vim_keycode) {
-    vim_dprintf_key("BEFORE", keycode, record);
-    bool result = vim_process_record_logged(keycode, record, vim_keycode);
-    vim_dprintf_key("AFTER", keycode, record);
-    VIM_DPRINT("\n");
+bool VIM_SRAM_FUNC(vim_process_record)(uint16_t keycode, const keyrecord_t *record, uint16_t vim_keycode) {
+    VIM_PROFILE_BEGIN(process_record);
+    current_vim_keycode = vim_keycode;
+    VIM_LOG(KEY, keycode, record->event.pressed, vim_get_mode(), vim_get_mods(),
+            vim_get_vim_key_state());
+    bool result = vim_macro_process_record(keycode, record) &&
+                  vim_process_record_logged(keycode, record, vim_keycode);
+    vim_mode_notify();
+    vim_check_invariants();
+    VIM_PROFILE_END(process_record, VIM_PROBE_PROCESS_RECORD);
     return result;
 }
 
+// Feeds the events of a playing macro through the same path as the real
+// ones. Keys that would be passed to the host in insert mode are sent directly.
+void vim_macro_feed(uint16_t keycode, bool pressed) {
+    keyrecord_t record = {.event = {.pressed = pressed, .time = timer_read()}};
+    VIM_LOG(KEY_MACRO, keycode, pressed, vim_get_mode());
+    if (vim_process_record_logged(keycode, &record, current_vim_keycode) &&
+        (IS_QK_BASIC(keycode) || IS_QK_MODS(keycode))) {
+        vim_send(keycode, pressed ? VIM_SEND_PRESS : VIM_SEND_RELEASE);
+    }
+}
+
+void vim_init(void) {
+    vim_profile_init();
+    vim_host_init();
+    vim_snapshot_restore();
+    vim_macro_init();
+    vim_stats_init();
+}
+
+void vim_shutdown(void) {
+    vim_snapshot_save();
+    vim_stats_save();
+}
+
 void vim_task(void) {
+#ifdef VIM_DEBUG
+    vim_log_flush();
+#endif
+    vim_profile_scan();
+    vim_timer_tick(timer_read());
+    vim_mode_notify();
+    vim_stats_task();
+    vim_check_invariants();
+}
+
+// Call this from command_extra. The magic key combination followed by P dumps
+// the VIM_PROFILE histograms, followed by S the VIM_STATS counters, and
+// followed by R the VIM_RECORDER events.
+bool vim_command_extra(uint8_t code) {
+    switch (code) {
+#ifdef VIM_PROFILE
+        case VIM_PROFILE_COMMAND_KEY:
+            vim_profile_dump();
+            return true;
+#endif
+#ifdef VIM_STATS
+        case VIM_STATS_COMMAND_KEY:
+            vim_stats_dump();
+            return true;
+#endif
+#ifdef VIM_RECORDER
+        case VIM_RECORDER_COMMAND_KEY:
+            vim_recorder_dump();
+            return true;
+#endif
+        default:
+            return false;
+    }
 }
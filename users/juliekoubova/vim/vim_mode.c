@@ -15,44 +15,122 @@
  */
 
 #include "debug.h"
+#include "ex.h"
+#include "fast_path.h"
 #include "pending.h"
 #include "perform_action.h"
 #include "quantum/quantum.h"
+#include "recorder.h"
+#include "repeat.h"
+#include "selection.h"
+#include "sram.h"
+#include "stats.h"
 #include "vim_mode.h"
 #include "vim_send.h"
 
 static vim_mode_t      vim_mode      = VIM_MODE_INSERT;
 static vim_key_state_t vim_key_state = VIM_KEY_NONE;
 static uint8_t         vim_mods      = 0; // we modify the actual mods so we can't rely on them
+static vim_mode_t      vim_notified  = VIM_MODE_INSERT;
+// the mods of a QK_MODS key while it's being processed, e.g. `$` on a layer,
+// or of a one-shot mod tapped before it
+static uint8_t         vim_key_mods  = 0;
+// the table the keys are looked up in follows from the mods above
+static vim_mod_class_t vim_mod_class = VIM_MOD_CLASS_NONE;
+// one-shot mods tapped outside insert mode wait for the next key, and stay with
+// it until it's released. held down, they are a one-shot only if nothing else
+// is pressed meanwhile.
+static uint8_t         vim_osm_mods     = 0;
+static uint8_t         vim_osm_held     = 0;
+static uint8_t         vim_osm_key_mods = 0;
+static uint16_t        vim_osm_keycode  = KC_NO;
+// running a single command from insert mode, until the key finishing it is up
+static bool            vim_oneshot         = false;
+static uint16_t        vim_oneshot_keycode = KC_NO;
 
-static void vim_cancel_os_selection(void) {
-    vim_send(KC_LEFT, VIM_SEND_TAP);
+// QMK's weak mods aren't part of it: in command mode, the ones of a QK_MODS
+// key are in vim_key_mods instead, and caps word is turned off.
+static void vim_mods_changed(void) {
+    uint8_t mods = vim_mods | vim_key_mods;
+    if (mods == 0) {
+        vim_mod_class = VIM_MOD_CLASS_NONE;
+    } else if (mods == MOD_BIT(KC_LSFT) || mods == MOD_BIT(KC_RSFT)) {
+        vim_mod_class = VIM_MOD_CLASS_SHIFT;
+    } else if (mods == MOD_BIT(KC_LCTL) || mods == MOD_BIT(KC_RCTL)) {
+        vim_mod_class = VIM_MOD_CLASS_CTRL;
+    } else {
+        vim_mod_class = VIM_MOD_CLASS_OTHER;
+    }
 }
 
 static void vim_set_mode(vim_mode_t mode) {
+    // the mods held in command mode are handed back to the host in insert mode
+    uint8_t host_mods = VIM_PASSES_KEYS(mode) ? vim_mods : 0;
+    bool    from_host = VIM_PASSES_KEYS(vim_mode);
+    if (vim_mode == VIM_MODE_INSERT) {
+        vim_repeat_insert_finished();
+    }
     vim_mode = mode;
-    vim_mods = mode == VIM_MODE_INSERT ? 0 : get_mods();
-    VIM_DPRINTF("entering mode=%d, capturing mods=%x\n", mode, vim_mods);
+    vim_set_slow_path(VIM_SLOW_PATH_MODE, mode != VIM_MODE_INSERT);
+    if (mode != VIM_MODE_COMMAND) {
+        // `Ctrl+O v` stays in visual mode
+        vim_oneshot = false;
+    }
+    if (VIM_PASSES_KEYS(mode)) {
+        // not handed to QMK, it would add them to the keys still being sent
+        vim_mods     = 0;
+        vim_osm_mods = 0;
+    } else if (from_host) {
+        // not what the host has right now, that may be a tap still being
+        // sent. between the other modes, vim_mods is already up to date.
+        vim_mods = vim_send_get_user_mods();
+#ifndef NO_ACTION_ONESHOT
+        // QMK would add them to the next report sent, whatever it is
+        vim_osm_mods |= get_oneshot_mods();
+        clear_oneshot_mods();
+#endif
+#ifdef CAPS_WORD_ENABLE
+        caps_word_off();
+#endif
+    }
+    vim_osm_held    = 0;
+    vim_osm_keycode = KC_NO;
+    vim_mods_changed();
+    VIM_LOG(MODE_SET, mode, vim_mods);
+    vim_record(VIM_RECORD_MODE, mode);
+    vim_stats_mode(mode);
+    if (vim_has_pending()) {
+        vim_stats_abandoned();
+    }
     vim_clear_pending();
-    clear_keyboard();
-    layer_state_set(default_layer_state);
-    vim_mode_changed(vim_mode);
+    // after whatever is still queued to be sent. the layers are left alone,
+    // layer keys work in every mode.
+    vim_send_clear(host_mods);
 }
 
-vim_mode_t vim_get_mode(void) {
+vim_mode_t VIM_SRAM_FUNC(vim_get_mode)(void) {
     return vim_mode;
 }
 
 __attribute__((weak)) void vim_mode_changed(vim_mode_t mode) {}
 
+// Calls vim_mode_changed once per key or task, and only if the mode is really
+// different, so a `.` that goes through insert mode and back doesn't redraw the
+// indicators twice.
+void VIM_SRAM_FUNC(vim_mode_notify)(void) {
+    if (vim_notified != vim_mode) {
+        vim_notified = vim_mode;
+        vim_mode_changed(vim_mode);
+    }
+}
+
 void vim_enter_insert_mode(void) {
     if (vim_mode == VIM_MODE_INSERT) {
         return;
     }
-    uint8_t mods = vim_mods;
-    VIM_DPRINTF("entering INSERT mode, restoring mods=%x\n", mods);
+    VIM_LOG(MODE_INSERT, vim_mods);
+    vim_selection_forget();
     vim_set_mode(VIM_MODE_INSERT);
-    register_mods(mods);
 }
 
 void vim_enter_command_mode(bool selection_cleared) {
@@ -61,14 +139,15 @@ void vim_enter_command_mode(bool selection_cleared) {
             return;
         case VIM_MODE_VISUAL:
         case VIM_MODE_VLINE:
+        case VIM_MODE_VBLOCK:
             if (!selection_cleared) {
-                vim_cancel_os_selection();
+                vim_selection_clear();
             }
             break;
         default:
             break;
     }
-    VIM_DPRINT("entering COMMAND mode\n");
+    VIM_LOG(MODE_COMMAND);
     vim_set_mode(VIM_MODE_COMMAND);
 }
 
@@ -76,25 +155,102 @@ void vim_enter_visual_mode(void) {
     if (vim_mode == VIM_MODE_VISUAL) {
         return;
     }
-    VIM_DPRINT("entering VISUAL mode\n");
+    VIM_LOG(MODE_VISUAL);
     // don't return to insert after vim key is released
     vim_set_vim_key_state(VIM_KEY_NONE);
+    vim_selection_entered(vim_mode, VIM_MODE_VISUAL);
     vim_set_mode(VIM_MODE_VISUAL);
 }
 
+#ifndef VIM_NO_VLINE
 void vim_enter_vline_mode(void) {
     if (vim_mode == VIM_MODE_VLINE) {
         return;
     }
-    VIM_DPRINT("entering V-LINE mode\n");
+    VIM_LOG(MODE_VLINE);
     // don't return to insert after vim key is released
     vim_set_vim_key_state(VIM_KEY_NONE);
-    vim_vline_entered();
+    vim_selection_entered(vim_mode, VIM_MODE_VLINE);
     vim_set_mode(VIM_MODE_VLINE);
 }
+#endif
+
+#ifndef VIM_NO_VBLOCK
+void vim_enter_vblock_mode(void) {
+    if (vim_mode == VIM_MODE_VBLOCK) {
+        return;
+    }
+    VIM_LOG(MODE_VBLOCK);
+    if (vim_mode == VIM_MODE_VISUAL || VIM_IS_VLINE(vim_mode)) {
+        // the block starts at the cursor, as it does from command mode
+        vim_selection_clear();
+    }
+    // don't return to insert after vim key is released
+    vim_set_vim_key_state(VIM_KEY_NONE);
+    vim_selection_entered(vim_mode, VIM_MODE_VBLOCK);
+    vim_set_mode(VIM_MODE_VBLOCK);
+}
+#endif
+
+void vim_enter_ex_mode(void) {
+    if (vim_mode == VIM_MODE_EX) {
+        return;
+    }
+    VIM_LOG(MODE_EX);
+    vim_set_vim_key_state(VIM_KEY_NONE);
+    vim_ex_clear();
+    vim_selection_forget();
+    vim_set_mode(VIM_MODE_EX);
+}
+
+void vim_enter_search_mode(void) {
+    if (vim_mode == VIM_MODE_SEARCH) {
+        return;
+    }
+    VIM_LOG(MODE_SEARCH);
+    vim_set_vim_key_state(VIM_KEY_NONE);
+    vim_selection_forget();
+    vim_set_mode(VIM_MODE_SEARCH);
+}
+
+bool vim_is_oneshot_chord(uint16_t keycode) {
+    uint8_t mods = vim_oneshot_chord_mods();
+    return keycode == VIM_ONESHOT_KEY && vim_mode == VIM_MODE_INSERT &&
+           (VIM_ONESHOT_MODS == 0 || ((mods & VIM_ONESHOT_MODS) && !(mods & ~VIM_ONESHOT_MODS)));
+}
+
+// The mods held for Ctrl+O are taken off the host like on any way to command
+// mode, and whatever is still held once the command is done goes back to it.
+// A one-shot Ctrl is used up by the chord, instead of by the command.
+// The vim key state is left alone.
+void vim_enter_oneshot(void) {
+    VIM_LOG(MODE_ONESHOT);
+#ifndef NO_ACTION_ONESHOT
+    del_oneshot_mods(VIM_ONESHOT_MODS);
+#endif
+    vim_set_mode(VIM_MODE_COMMAND);
+    vim_oneshot         = true;
+    vim_oneshot_keycode = KC_NO;
+}
+
+// Called with every key handled in command mode. The one that completes a
+// command, and doesn't leave anything pending, ends the one-shot once it's
+// released, so that a held motion still repeats.
+void vim_oneshot_key(uint16_t keycode, bool pressed) {
+    if (!vim_oneshot || vim_mode != VIM_MODE_COMMAND) {
+        return;
+    }
+    if (pressed) {
+        if (!vim_has_pending()) {
+            vim_oneshot_keycode = keycode;
+        }
+    } else if (keycode == vim_oneshot_keycode) {
+        vim_enter_insert_mode();
+    }
+}
 
 void vim_enter_mode(vim_mode_t mode, bool selection_cleared) {
-    VIM_DPRINTF("vim_enter_mode: %d\n", mode);
+    VIM_LOG(MODE_ENTER, mode);
     switch (mode) {
         case VIM_MODE_INSERT:
             vim_enter_insert_mode();
@@ -102,23 +258,108 @@ void vim_enter_mode(vim_mode_t mode, bool selection_cleared) {
         case VIM_MODE_VISUAL:
             vim_enter_visual_mode();
             break;
+#ifndef VIM_NO_VLINE
         case VIM_MODE_VLINE:
             vim_enter_vline_mode();
             break;
+#endif
+#ifndef VIM_NO_VBLOCK
+        case VIM_MODE_VBLOCK:
+            vim_enter_vblock_mode();
+            break;
+#endif
         case VIM_MODE_COMMAND:
             vim_enter_command_mode(selection_cleared);
             break;
+        case VIM_MODE_EX:
+            vim_enter_ex_mode();
+            break;
+        case VIM_MODE_SEARCH:
+            vim_enter_search_mode();
+            break;
+        default:
+            break;
+    }
+}
+
+// Sets the mode without touching the keyboard state or sending any keys, for
+// restoring it after a reset. Whatever was selected is still selected on the
+// host side.
+void vim_restore_mode(vim_mode_t mode) {
+    if (mode < VIM_MODE_INSERT || mode >= VIM_MODE_COUNT) {
+        return;
+    }
+#ifdef VIM_NO_VLINE
+    // saved by a firmware that still had it
+    if (mode == VIM_MODE_VLINE) {
+        mode = VIM_MODE_VISUAL;
     }
+#endif
+#ifdef VIM_NO_VBLOCK
+    if (mode == VIM_MODE_VBLOCK) {
+        mode = VIM_MODE_COMMAND;
+    }
+#endif
+    VIM_LOG(MODE_RESTORE, mode);
+    vim_record(VIM_RECORD_MODE, mode);
+    vim_mode = mode;
+    vim_set_slow_path(VIM_SLOW_PATH_MODE, mode != VIM_MODE_INSERT);
 }
 
 void vim_set_mod(uint16_t keycode, bool pressed) {
-    uint8_t bit = MOD_BIT(keycode);
-    vim_mods    = pressed ? (vim_mods | bit) : (vim_mods & ~bit);
-    VIM_DPRINTF("vim_mods = %x\n", vim_mods);
+    vim_update_mods(MOD_BIT(keycode), pressed);
 }
 
-uint8_t vim_get_mods(void) {
-    return vim_mods;
+void vim_update_mods(uint8_t mods, bool pressed) {
+    vim_mods = pressed ? (vim_mods | mods) : (vim_mods & ~mods);
+    VIM_LOG(MODS, vim_mods);
+    vim_mods_changed();
+}
+
+void vim_set_key_mods(uint8_t mods) {
+    if (vim_key_mods != mods) {
+        vim_key_mods = mods;
+        vim_mods_changed();
+    }
+}
+
+// OSM() keys outside insert mode. QMK's own one-shot mods would reach the host.
+void vim_process_oneshot_mods(uint8_t mods, bool pressed) {
+    vim_update_mods(mods, pressed);
+    if (pressed) {
+        vim_osm_held |= mods;
+    } else if (vim_osm_held & mods) {
+        vim_osm_held &= ~mods;
+        vim_osm_mods |= mods;
+        VIM_LOG(MODS_ONESHOT, vim_osm_mods);
+    }
+}
+
+// Returns the one-shot mods that apply to the key, and consumes them
+uint8_t vim_take_oneshot_mods(uint16_t keycode, bool pressed) {
+    uint8_t mods = 0;
+    if (pressed) {
+        // an OSM() key held down meanwhile is just a mod
+        vim_osm_held = 0;
+        if (vim_osm_mods) {
+            mods             = vim_osm_mods;
+            vim_osm_mods     = 0;
+            vim_osm_key_mods = mods;
+            vim_osm_keycode  = keycode;
+        }
+    } else if (keycode == vim_osm_keycode) {
+        mods            = vim_osm_key_mods;
+        vim_osm_keycode = KC_NO;
+    }
+    return mods;
+}
+
+uint8_t VIM_SRAM_FUNC(vim_get_mods)(void) {
+    return vim_mods | vim_key_mods;
+}
+
+vim_mod_class_t VIM_SRAM_FUNC(vim_get_mod_class)(void) {
+    return vim_mod_class;
 }
 
 vim_key_state_t vim_get_vim_key_state(void) {
@@ -130,9 +371,3 @@ vim_key_state_t vim_set_vim_key_state(vim_key_state_t key_state) {
     vim_key_state        = key_state;
     return prev;
 }
-
-void vim_dprintf_key(const char *prefix, uint16_t keycode, const keyrecord_t *record) {
-    VIM_DPRINTF("%s %s keycode=%x: mode=%d mods=%x vim_key=%x\n", prefix,
-                record->event.pressed ? "pressed" : "released", keycode, vim_mode, vim_mods,
-                vim_key_state);
-}
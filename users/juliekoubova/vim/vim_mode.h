@@ -19,17 +19,77 @@
 #include <stdint.h>
 #include "quantum/quantum.h"
 
+// Ctrl+O in insert mode runs a single command and goes back to insert mode.
+// Set VIM_ONESHOT_KEY to a keycode of your own and VIM_ONESHOT_MODS to 0 to use
+// a dedicated key instead, or to KC_NO to turn it off.
+#ifndef VIM_ONESHOT_KEY
+#    define VIM_ONESHOT_KEY KC_O
+#endif
+#ifndef VIM_ONESHOT_MODS
+#    define VIM_ONESHOT_MODS MOD_MASK_CTRL
+#endif
+
+// The mods of the chord can be held or tapped as one-shot mods
+static inline uint8_t vim_oneshot_chord_mods(void) {
+    uint8_t mods = get_mods();
+#ifndef NO_ACTION_ONESHOT
+    mods |= get_oneshot_mods();
+#endif
+    return mods;
+}
+
+// Whether the key may be the chord, cheap enough for the fast path. A typed
+// `o` doesn't get any further.
+static inline bool vim_may_be_oneshot_chord(uint16_t keycode) {
+    return keycode == VIM_ONESHOT_KEY &&
+           (VIM_ONESHOT_MODS == 0 || (vim_oneshot_chord_mods() & VIM_ONESHOT_MODS));
+}
+
 typedef enum {
     VIM_MODE_INSERT = 1,
     VIM_MODE_COMMAND,
     VIM_MODE_VISUAL,
     VIM_MODE_VLINE,
+    VIM_MODE_EX,
+    VIM_MODE_SEARCH,
+    VIM_MODE_VBLOCK,
+    VIM_MODE_COUNT,
 } vim_mode_t;
 
+// With VIM_NO_VLINE, v-line mode is compiled out, along with its tables.
+#ifdef VIM_NO_VLINE
+#    define VIM_IS_VLINE(mode) false
+#else
+#    define VIM_IS_VLINE(mode) ((mode) == VIM_MODE_VLINE)
+#endif
+
+// With VIM_NO_VBLOCK, so is v-block mode.
+#ifdef VIM_NO_VBLOCK
+#    define VIM_IS_VBLOCK(mode) false
+#else
+#    define VIM_IS_VBLOCK(mode) ((mode) == VIM_MODE_VBLOCK)
+#endif
+
+// In insert and search mode, the keys and the mods held go to the host
+#define VIM_PASSES_KEYS(mode) ((mode) == VIM_MODE_INSERT || (mode) == VIM_MODE_SEARCH)
+
 typedef enum { VIM_KEY_NONE, VIM_KEY_TAP, VIM_KEY_HELD } vim_key_state_t;
 
-void    vim_set_mod(uint16_t keycode, bool pressed);
-uint8_t vim_get_mods(void);
+// Which of the key tables the mods select, updated whenever they change
+typedef enum {
+    VIM_MOD_CLASS_NONE,
+    VIM_MOD_CLASS_SHIFT,
+    VIM_MOD_CLASS_CTRL,
+    VIM_MOD_CLASS_OTHER,
+} vim_mod_class_t;
+
+void            vim_set_mod(uint16_t keycode, bool pressed);
+void            vim_update_mods(uint8_t mods, bool pressed);
+void            vim_set_key_mods(uint8_t mods);
+void            vim_process_oneshot_mods(uint8_t mods, bool pressed);
+uint8_t         vim_take_oneshot_mods(uint16_t keycode, bool pressed);
+uint8_t         vim_get_mods(void);
+vim_mod_class_t vim_get_mod_class(void);
 
 vim_key_state_t vim_get_vim_key_state(void);
 vim_key_state_t vim_set_vim_key_state(vim_key_state_t);
@@ -37,9 +97,20 @@ vim_key_state_t vim_set_vim_key_state(vim_key_state_t);
 void       vim_enter_command_mode(bool selection_cleared);
 void       vim_enter_insert_mode(void);
 void       vim_enter_visual_mode(void);
+#ifndef VIM_NO_VLINE
 void       vim_enter_vline_mode(void);
+#endif
+#ifndef VIM_NO_VBLOCK
+void       vim_enter_vblock_mode(void);
+#endif
+void       vim_enter_ex_mode(void);
+void       vim_enter_search_mode(void);
+bool       vim_is_oneshot_chord(uint16_t keycode);
+void       vim_enter_oneshot(void);
+void       vim_oneshot_key(uint16_t keycode, bool pressed);
 void       vim_enter_mode(vim_mode_t mode, bool selection_cleared);
+void       vim_restore_mode(vim_mode_t mode);
 vim_mode_t vim_get_mode(void);
 void       vim_mode_changed(vim_mode_t mode);
+void       vim_mode_notify(void);
 
-void vim_dprintf_key(const char *prefix, uint16_t keycode, const keyrecord_t *record);
@@ -16,51 +16,316 @@
 
 #include "vim_send.h"
 #include "debug.h"
+#include "fast_path.h"
+#include "minimal.h"
+#include "profile.h"
 #include "quantum/quantum.h"
+#include "recorder.h"
+#include "sram.h"
+#include "timer_wheel.h"
 
-#define VIM_TAP_DELAY 30
+// Taps are sent asynchronously: the key is pressed right away and released
+// VIM_TAP_DELAY later from the timer wheel. Anything sent meanwhile waits in
+// the queue, so the host always sees the keys in order.
+#ifndef VIM_SEND_QUEUE_SIZE
+#    define VIM_SEND_QUEUE_SIZE 32
+#endif
 
-void vim_send(uint16_t code16, vim_send_type_t type) {
-    uint8_t mods    = QK_MODS_GET_MODS(code16);
-    uint8_t keycode = QK_MODS_GET_BASIC_KEYCODE(code16);
+// a held motion, see vim_send_repeated
+#define VIM_SEND_HOLD 0x4
+// queued only, clear the keyboard but leave the mods in the keycode held
+#define VIM_SEND_CLEAR 0x8
+// queued only, the keycode is the number of wheel detents, positive is up
+#define VIM_SEND_WHEEL 0x40
 
-    if (type & VIM_SEND_PRESS) {
-        if (mods) {
-            VIM_DPRINTF("register mods=%x\n", mods);
-            register_mods(mods);
+typedef struct {
+    uint16_t code16;
+    uint8_t  type;
+} vim_send_op_t;
+
+static bool     vim_send_tapping = false;
+static uint16_t vim_send_tapped  = KC_NO;
+// only one motion is held at a time, the host only repeats the last key anyway
+static uint16_t vim_send_held    = KC_NO;
+// the mods of a key typed while the queue was busy, e.g. the Shift of `$`
+static uint8_t  vim_send_typed   = 0;
+
+// mods that QMK released meanwhile, a mode change still queued mustn't hold
+// them again
+static uint8_t vim_send_released_mods = 0;
+// the mods held on the keyboard, as the host will see them once everything
+// queued has been sent
+static uint8_t vim_send_user_mods = 0;
+
+static void VIM_SRAM_FUNC(vim_send_register)(uint16_t code16) {
+    uint8_t mods = QK_MODS_GET_MODS(code16);
+    if (mods) {
+        VIM_LOG(SEND_MODS, mods);
+        register_mods(mods);
+    }
+    VIM_LOG(SEND_KEY, QK_MODS_GET_BASIC_KEYCODE(code16));
+    register_code(QK_MODS_GET_BASIC_KEYCODE(code16));
+    vim_record(VIM_RECORD_SEND_DOWN, code16);
+}
+
+// A tap doesn't release what is still held, e.g. Shift when `$` is tapped while
+// holding `h` in visual mode.
+static void VIM_SRAM_FUNC(vim_send_unregister)(uint16_t code16) {
+    uint8_t mods = QK_MODS_GET_MODS(code16) & ~QK_MODS_GET_MODS(vim_send_held);
+    uint8_t key  = QK_MODS_GET_BASIC_KEYCODE(code16);
+    if (key != QK_MODS_GET_BASIC_KEYCODE(vim_send_held)) {
+        VIM_LOG(SEND_KEY_UP, key);
+        unregister_code(key);
+    } else {
+        key = KC_NO;
+    }
+    if (mods) {
+        VIM_LOG(SEND_MODS_UP, mods);
+        unregister_mods(mods);
+    }
+    vim_record(VIM_RECORD_SEND_UP, mods << 8 | key);
+}
+
+// Returns true when the op is a tap that still needs to be released.
+static bool VIM_SRAM_FUNC(vim_send_perform)(vim_send_op_t op) {
+    if (op.type == VIM_SEND_CLEAR) {
+        // most mode changes find the keyboard clear already, so don't send
+        // a report, or two, that the host can't tell from the last one
+        uint8_t mods = op.code16 & ~vim_send_released_mods;
+        if (get_mods() != mods || get_weak_mods() || has_anykey()) {
+            VIM_LOG(SEND_CLEAR, mods);
+            set_mods(mods);
+            clear_keyboard_but_mods();
+            vim_record(VIM_RECORD_SEND_CLEAR, mods);
+        }
+        vim_send_held  = KC_NO;
+        vim_send_typed = 0;
+        return false;
+    }
+#ifdef MOUSE_ENABLE
+    if (op.type == VIM_SEND_WHEEL) {
+        // a single report scrolls up to 127 detents
+        int16_t detents = op.code16;
+        while (detents) {
+            report_mouse_t report = {.v = detents > 127 ? 127 : detents < -127 ? -127 : detents};
+            VIM_LOG(SEND_WHEEL, report.v);
+            host_mouse_send(&report);
+            vim_record(VIM_RECORD_SEND_WHEEL, report.v);
+            detents -= report.v;
+        }
+        return false;
+    }
+#endif
+    if (op.type & VIM_SEND_HOLD) {
+        uint16_t held = vim_send_held;
+        if (op.type & VIM_SEND_PRESS) {
+            // holding `b` and then `j` would otherwise send Ctrl+Down
+            vim_send_held = KC_NO;
+            if (held != KC_NO) {
+                vim_send_unregister(held);
+            }
+            vim_send_held = op.code16;
+            vim_send_register(op.code16);
+        } else if (QK_MODS_GET_BASIC_KEYCODE(op.code16) == QK_MODS_GET_BASIC_KEYCODE(held)) {
+            // the mods may have changed since, release what was pressed. a
+            // motion released after another one, or after a mode change, is
+            // already up.
+            vim_send_held = KC_NO;
+            vim_send_unregister(held);
+        }
+        return false;
+    }
+    if (op.type == VIM_SEND_PRESS) {
+        vim_send_typed |= QK_MODS_GET_MODS(op.code16);
+    } else if (op.type == VIM_SEND_RELEASE) {
+        vim_send_typed &= ~QK_MODS_GET_MODS(op.code16);
+    }
+    if (op.type & VIM_SEND_PRESS) {
+        vim_send_register(op.code16);
+        if (op.type & VIM_SEND_RELEASE) {
+            vim_send_tapping = true;
+            vim_send_tapped  = op.code16;
+            return true;
         }
-        VIM_DPRINTF("register keycode=%x\n", keycode);
-        register_code(keycode);
-        if (type & VIM_SEND_RELEASE) {
-            wait_ms(VIM_TAP_DELAY);
+    }
+    if (op.type & VIM_SEND_RELEASE) {
+        vim_send_unregister(op.code16);
+    }
+    return false;
+}
+
+static vim_send_op_t vim_send_queue[VIM_SEND_QUEUE_SIZE];
+static uint8_t       vim_send_head  = 0;
+static uint8_t       vim_send_count = 0;
+
+static void vim_send_emit(void) {
+    VIM_PROFILE_BEGIN(emit);
+    if (vim_send_tapping) {
+        vim_send_tapping = false;
+        vim_send_unregister(vim_send_tapped);
+    }
+    while (vim_send_count) {
+        vim_send_op_t op = vim_send_queue[vim_send_head];
+        vim_send_head    = (vim_send_head + 1) % VIM_SEND_QUEUE_SIZE;
+        vim_send_count--;
+        if (vim_send_perform(op)) {
+            vim_timer_schedule(VIM_TIMER_EMIT, VIM_TAP_DELAY, vim_send_emit);
+            break;
         }
     }
-    if (type & VIM_SEND_RELEASE) {
-        VIM_DPRINTF("unregister keycode=%x\n", keycode);
-        unregister_code(keycode);
-        if (mods) {
-            VIM_DPRINTF("unregister mods=%x\n", mods);
-            unregister_mods(mods);
+    if (!vim_send_busy()) {
+        vim_send_released_mods = 0;
+        vim_set_slow_path(VIM_SLOW_PATH_SEND, false);
+    }
+    VIM_PROFILE_END(emit, VIM_PROBE_EMIT);
+}
+
+static void VIM_SRAM_FUNC(vim_send_enqueue)(uint16_t code16, uint8_t type) {
+    vim_send_op_t op = {.code16 = code16, .type = type};
+    while (vim_send_count == VIM_SEND_QUEUE_SIZE) {
+        // out of room, so fall back to sending synchronously
+        VIM_LOG(SEND_QUEUE_FULL);
+        vim_timer_cancel(VIM_TIMER_EMIT);
+        wait_ms(VIM_TAP_DELAY);
+        vim_send_emit();
+    }
+    // checked after making room, that may have emptied the queue completely
+    if (!vim_send_busy()) {
+        if (vim_send_perform(op)) {
+            vim_set_slow_path(VIM_SLOW_PATH_SEND, true);
+            vim_timer_schedule(VIM_TIMER_EMIT, VIM_TAP_DELAY, vim_send_emit);
         }
+        return;
+    }
+    vim_send_queue[(vim_send_head + vim_send_count) % VIM_SEND_QUEUE_SIZE] = op;
+    vim_send_count++;
+}
+
+bool vim_send_busy(void) {
+    return vim_send_tapping || vim_send_count;
+}
+
+static void VIM_SRAM_FUNC(vim_send_track_user_mods)(uint16_t code16, uint8_t type) {
+    if (!vim_send_busy()) {
+        vim_send_user_mods = vim_send_get_user_mods();
+    }
+    if (type == VIM_SEND_CLEAR) {
+        vim_send_user_mods = code16;
+    } else if (IS_MODIFIER_KEYCODE(code16) && type == VIM_SEND_PRESS) {
+        vim_send_user_mods |= MOD_BIT(code16);
+    } else if (IS_MODIFIER_KEYCODE(code16) && type == VIM_SEND_RELEASE) {
+        vim_send_user_mods &= ~MOD_BIT(code16);
     }
 }
 
+void VIM_SRAM_FUNC(vim_send)(uint16_t code16, vim_send_type_t type) {
+    VIM_PROFILE_BEGIN(send);
+    if (type != VIM_SEND_NONE) {
+        vim_send_track_user_mods(code16, type);
+        vim_send_enqueue(code16, type);
+    }
+    VIM_PROFILE_END(send, VIM_PROBE_SEND);
+}
+
+void vim_send_release_mods(uint8_t mods) {
+    if (vim_send_busy()) {
+        vim_send_released_mods |= mods;
+        vim_send_user_mods &= ~mods;
+    }
+}
+
+void vim_send_clear(uint8_t mods) {
+    vim_send_track_user_mods(mods, VIM_SEND_CLEAR);
+    vim_send_enqueue(mods, VIM_SEND_CLEAR);
+}
+
+#ifdef MOUSE_ENABLE
+void vim_send_wheel(int16_t detents) {
+    vim_send_enqueue(detents, VIM_SEND_WHEEL);
+}
+#endif
+
+// The mods of a tap that is waiting to be released, of a held motion, and of
+// a `$` typed while the queue was busy. These aren't held on the keyboard.
+uint8_t vim_send_get_mods(void) {
+    uint8_t mods = QK_MODS_GET_MODS(vim_send_held) | vim_send_typed;
+    return vim_send_tapping ? mods | QK_MODS_GET_MODS(vim_send_tapped) : mods;
+}
+
+// The mods held on the keyboard. Keys typed while the queue is busy only reach
+// the host later, and a mode change may still be waiting to clear it.
+uint8_t VIM_SRAM_FUNC(vim_send_get_user_mods)(void) {
+    return vim_send_busy() ? vim_send_user_mods : get_mods() & ~vim_send_get_mods();
+}
+
+// The motion being held, e.g. `h` held down without VIM_REPEAT_ACCELERATION.
+uint16_t vim_send_get_held(void) {
+    return vim_send_held;
+}
+
 void vim_send_multi(const uint16_t* code16s, size_t count) {
     for (size_t i = 0; i < count; i++) {
         vim_send(code16s[i], VIM_SEND_TAP);
     }
 }
 
+// With VIM_REPEAT_ACCELERATION, held motions aren't held on the host and left
+// to its key repeat. They are tapped from the timer wheel instead, faster and
+// faster, the same on every host.
+#ifdef VIM_REPEAT_ACCELERATION
+#    ifndef VIM_REPEAT_DELAY
+#        define VIM_REPEAT_DELAY 250
+#    endif
+#    ifndef VIM_REPEAT_INTERVAL
+#        define VIM_REPEAT_INTERVAL 60
+#    endif
+#    ifndef VIM_REPEAT_INTERVAL_MIN
+#        define VIM_REPEAT_INTERVAL_MIN 10
+#    endif
+#    ifndef VIM_REPEAT_INTERVAL_STEP
+#        define VIM_REPEAT_INTERVAL_STEP 5
+#    endif
+
+static uint16_t vim_repeat_code16   = KC_NO;
+static uint16_t vim_repeat_interval = VIM_REPEAT_INTERVAL;
+
+static void vim_send_autorepeat(void) {
+    // don't pile up taps while the queue is still draining
+    if (!vim_send_busy()) {
+        vim_send(vim_repeat_code16, VIM_SEND_TAP);
+    }
+    if (vim_repeat_interval >= VIM_REPEAT_INTERVAL_MIN + VIM_REPEAT_INTERVAL_STEP) {
+        vim_repeat_interval -= VIM_REPEAT_INTERVAL_STEP;
+    } else {
+        vim_repeat_interval = VIM_REPEAT_INTERVAL_MIN;
+    }
+    vim_timer_schedule(VIM_TIMER_AUTOREPEAT, vim_repeat_interval, vim_send_autorepeat);
+}
+#endif
+
 void vim_send_repeated(int8_t repeat, uint16_t code16, vim_send_type_t type) {
     if (type == VIM_SEND_RELEASE) {
-        vim_send(code16, type);
+#ifdef VIM_REPEAT_ACCELERATION
+        vim_timer_cancel(VIM_TIMER_AUTOREPEAT);
+#else
+        vim_send(code16, type | VIM_SEND_HOLD);
+#endif
         return;
     }
     while (repeat > 1) {
         vim_send(code16, VIM_SEND_TAP);
         repeat--;
     }
-    vim_send(code16, type);
+#ifdef VIM_REPEAT_ACCELERATION
+    if (type == VIM_SEND_PRESS) {
+        vim_send(code16, VIM_SEND_TAP);
+        vim_repeat_code16   = code16;
+        vim_repeat_interval = VIM_REPEAT_INTERVAL;
+        vim_timer_schedule(VIM_TIMER_AUTOREPEAT, VIM_REPEAT_DELAY, vim_send_autorepeat);
+        return;
+    }
+#endif
+    vim_send(code16, type == VIM_SEND_PRESS ? type | VIM_SEND_HOLD : type);
 }
 
 void vim_send_repeated_multi(int8_t repeat, const uint16_t* code16s, uint8_t code16_count) {
@@ -69,4 +334,3 @@ void vim_send_repeated_multi(int8_t repeat, const uint16_t* code16s, uint8_t cod
         repeat--;
     }
 }
-
@@ -15,9 +15,14 @@
  */
 
 #pragma once
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#ifndef VIM_TAP_DELAY
+#    define VIM_TAP_DELAY 30
+#endif
+
 typedef enum {
     VIM_SEND_NONE    = 0x0,
     VIM_SEND_PRESS   = 0x1,
@@ -25,8 +30,14 @@ typedef enum {
     VIM_SEND_TAP     = VIM_SEND_PRESS | VIM_SEND_RELEASE
 } vim_send_type_t;
 
-void vim_send(uint16_t keycode, vim_send_type_t);
-void vim_send_multi(const uint16_t* code16s, size_t count);
-void vim_send_repeated(int8_t repeat, uint16_t code16, vim_send_type_t type);
-void vim_send_repeated_multi(int8_t repeat, const uint16_t* code16s, uint8_t code16_count);
-
+void     vim_send(uint16_t keycode, vim_send_type_t);
+void     vim_send_clear(uint8_t mods);
+void     vim_send_release_mods(uint8_t mods);
+void     vim_send_wheel(int16_t detents);
+void     vim_send_multi(const uint16_t* code16s, size_t count);
+void     vim_send_repeated(int8_t repeat, uint16_t code16, vim_send_type_t type);
+void     vim_send_repeated_multi(int8_t repeat, const uint16_t* code16s, uint8_t code16_count);
+bool     vim_send_busy(void);
+uint8_t  vim_send_get_mods(void);
+uint8_t  vim_send_get_user_mods(void);
+uint16_t vim_send_get_held(void);